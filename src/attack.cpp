@@ -4,6 +4,7 @@
 // includes
 
 #include "attack.h"
+#include "bitboard.h"
 #include "board.h"
 #include "colour.h"
 #include "move.h"
@@ -244,73 +245,58 @@ static void add_attack(int piece, int king, int target) {
 
 bool is_attacked(const board_t * board, int to, int colour) {
 
-   int inc;
-   int pawn;
-   const sq_t * ptr;
-   int from;
-   int piece;
-   int delta;
-   int sq;
+   int to_64;
+   const uint64 * bb;
 
    ASSERT(board!=NULL);
    ASSERT(SQUARE_IS_OK(to));
    ASSERT(COLOUR_IS_OK(colour));
 
-   // pawn attack
+   to_64 = SQUARE_TO_64(to);
+   bb = &board->piece_bb[colour]; // HACK: the colour is the low bit of the 12-piece index
 
-   inc = PAWN_MOVE_INC(colour);
-   pawn = PAWN_MAKE(colour);
+   // cheapest first, see attackers()
 
-   if (board->square[to-(inc-1)] == pawn) return true;
-   if (board->square[to-(inc+1)] == pawn) return true;
+   if ((PawnAttackBB[COLOUR_OPP(colour)][to_64] & bb[WhitePawn12]) != 0) return true;
+   if ((KnightAttackBB[to_64] & bb[WhiteKnight12]) != 0) return true;
+   if ((KingAttackBB[to_64] & bb[WhiteKing12]) != 0) return true;
+   if ((BISHOP_ATTACK(to_64,board->occupied) & (bb[WhiteBishop12] | bb[WhiteQueen12])) != 0) return true;
+   if ((ROOK_ATTACK(to_64,board->occupied) & (bb[WhiteRook12] | bb[WhiteQueen12])) != 0) return true;
 
-   // piece attack
+   return false;
+}
 
-   for (ptr = &board->piece[colour][0]; (from=*ptr) != SquareNone; ptr++) {
+// attackers()
 
-      piece = board->square[from];
-      delta = to - from;
+uint64 attackers(const board_t * board, int to, int colour) {
 
-      if (PSEUDO_ATTACK(piece,delta)) {
+   int to_64;
+   const uint64 * bb;
 
-         inc = DELTA_INC_ALL(delta);
-         ASSERT(inc!=IncNone);
+   ASSERT(board!=NULL);
+   ASSERT(SQUARE_IS_OK(to));
+   ASSERT(COLOUR_IS_OK(colour));
 
-         sq = from;
-         do {
-            sq += inc;
-            if (sq == to) return true;
-         } while (board->square[sq] == Empty);
-      }
-   }
+   to_64 = SQUARE_TO_64(to);
+   bb = &board->piece_bb[colour]; // HACK: the colour is the low bit of the 12-piece index
 
-   return false;
+   return (PawnAttackBB[COLOUR_OPP(colour)][to_64] & bb[WhitePawn12])
+        | (KnightAttackBB[to_64] & bb[WhiteKnight12])
+        | (KingAttackBB[to_64] & bb[WhiteKing12])
+        | (BISHOP_ATTACK(to_64,board->occupied) & (bb[WhiteBishop12] | bb[WhiteQueen12]))
+        | (ROOK_ATTACK(to_64,board->occupied) & (bb[WhiteRook12] | bb[WhiteQueen12]));
 }
 
 // line_is_empty()
 
 bool line_is_empty(const board_t * board, int from, int to) {
 
-   int delta;
-   int inc, sq;
-
    ASSERT(board!=NULL);
    ASSERT(SQUARE_IS_OK(from));
    ASSERT(SQUARE_IS_OK(to));
+   ASSERT(DELTA_INC_ALL(to-from)!=IncNone);
 
-   delta = to - from;
-   ASSERT(delta_is_ok(delta));
-
-   inc = DELTA_INC_ALL(delta);
-   ASSERT(inc!=IncNone);
-
-   sq = from;
-   do {
-      sq += inc;
-      if (sq == to) return true;
-   } while (board->square[sq] == Empty);
-
-   return false; // blocker
+   return (BETWEEN(from,to) & board->occupied) == 0;
 }
 
 // is_pinned()
@@ -331,10 +317,7 @@ bool is_pinned(const board_t * board, int square, int colour) {
    inc = DELTA_INC_LINE(to-from);
    if (inc == IncNone) return false; // not a line
 
-   sq = from;
-   do sq += inc; while (board->square[sq] == Empty);
-
-   if (sq != to) return false; // blocker
+   if ((BETWEEN(from,to) & board->occupied) != 0) return false; // blocker
 
    sq = from;
    do sq -= inc; while ((piece=board->square[sq]) == Empty);
@@ -0,0 +1,355 @@
+
+// bitboard.cpp
+
+// includes
+
+#include "bitboard.h"
+#include "colour.h"
+#include "piece.h"
+#include "posix.h"
+#include "square.h"
+#include "util.h"
+#include "vector.h"
+
+#if PEXT && defined(_MSC_VER)
+#  include <intrin.h> // __cpuidex()
+#endif
+
+// constants
+
+static const int BishopTableSize = 0x1480; // 41 kB
+static const int RookTableSize = 0x19000; // 800 kB
+
+static const uint64 MagicSeed[8] = { // per rank, they find all the magics quickly
+   728, 10316, 55013, 32803, 12281, 15100, 16645, 255,
+};
+
+// variables
+
+uint64 SquareBit[SquareNb];
+
+uint64 PawnAttackBB[ColourNb][64]; // squares attacked by a pawn of that colour
+uint64 KnightAttackBB[64];
+uint64 KingAttackBB[64];
+
+uint64 Between[64][64]; // squares strictly between two aligned squares, 32 kB
+
+magic_t BishopMagic[64];
+magic_t RookMagic[64];
+
+bool UsePext; // index the slider tables with PEXT instead of a magic multiply
+
+static uint64 BishopTable[BishopTableSize];
+static uint64 RookTable[RookTableSize];
+
+// prototypes
+
+static void   magic_init   (magic_t magic[], uint64 table[], int table_size, const inc_t inc[]);
+static uint64 ray_attack   (int square, const inc_t inc[], uint64 occupied);
+static uint64 magic_random (uint64 * seed);
+
+// functions
+
+// bitboard_init()
+
+void bitboard_init() {
+
+   int sq, sq_64, to;
+   int colour;
+   int dir, inc;
+   uint64 b;
+
+   // SquareBit[]
+
+   for (sq = 0; sq < SquareNb; sq++) SquareBit[sq] = 0;
+
+   for (sq_64 = 0; sq_64 < 64; sq_64++) {
+      SquareBit[SQUARE_FROM_64(sq_64)] = U64(1) << sq_64;
+   }
+
+   // attacks of the non-sliding pieces
+
+   for (sq_64 = 0; sq_64 < 64; sq_64++) {
+
+      sq = SQUARE_FROM_64(sq_64);
+
+      for (colour = 0; colour < ColourNb; colour++) {
+         inc = PAWN_MOVE_INC(colour);
+         PawnAttackBB[colour][sq_64] = SQUARE_BIT(sq+inc-1) | SQUARE_BIT(sq+inc+1);
+      }
+
+      KnightAttackBB[sq_64] = 0;
+      for (dir = 0; (inc=KnightInc[dir]) != IncNone; dir++) {
+         if (SQUARE_IS_OK(sq+inc)) KnightAttackBB[sq_64] |= SQUARE_BIT(sq+inc);
+      }
+
+      KingAttackBB[sq_64] = 0;
+      for (dir = 0; (inc=KingInc[dir]) != IncNone; dir++) {
+         if (SQUARE_IS_OK(sq+inc)) KingAttackBB[sq_64] |= SQUARE_BIT(sq+inc);
+      }
+   }
+
+   // Between[][]
+
+   for (sq_64 = 0; sq_64 < 64; sq_64++) {
+
+      sq = SQUARE_FROM_64(sq_64);
+
+      for (to = 0; to < 64; to++) Between[sq_64][to] = 0;
+
+      for (dir = 0; (inc=QueenInc[dir]) != IncNone; dir++) {
+         b = 0;
+         for (to = sq+inc; SQUARE_IS_OK(to); to += inc) {
+            Between[sq_64][SQUARE_TO_64(to)] = b;
+            b |= SQUARE_BIT(to);
+         }
+      }
+   }
+
+   // sliders
+
+   UsePext = bitboard_pext();
+
+   magic_init(BishopMagic,BishopTable,BishopTableSize,BishopInc);
+   magic_init(RookMagic,RookTable,RookTableSize,RookInc);
+}
+
+// magic_init()
+
+static void magic_init(magic_t magic[], uint64 table[], int table_size, const inc_t inc[]) {
+
+   static uint64 occupancy[4096], reference[4096];
+   static int age[4096];
+
+   int sq_64, sq;
+   int size, i, index;
+   int epoch;
+   uint64 edges, b;
+   uint64 seed;
+   magic_t * m;
+
+   ASSERT(magic!=NULL);
+   ASSERT(table!=NULL);
+   ASSERT(inc!=NULL);
+
+   size = 0;
+   epoch = 0;
+
+   for (i = 0; i < 4096; i++) age[i] = 0;
+
+   for (sq_64 = 0; sq_64 < 64; sq_64++) {
+
+      sq = SQUARE_FROM_64(sq_64);
+      m = &magic[sq_64];
+
+      // the edges never block, unless the slider stands on them
+
+      edges = ((U64(0x00000000000000FF) | U64(0xFF00000000000000)) & ~(U64(0xFF) << (sq_64 & ~7)))
+            | ((U64(0x0101010101010101) | U64(0x8080808080808080)) & ~(U64(0x0101010101010101) << (sq_64 & 7)));
+
+      m->mask = ray_attack(sq,inc,0) & ~edges;
+      m->shift = 64 - BB_COUNT(m->mask);
+      m->attack = &table[size];
+
+      // all blocker subsets (carry-rippler)
+
+      i = 0;
+      b = 0;
+
+      do {
+         occupancy[i] = b;
+         reference[i] = ray_attack(sq,inc,b);
+         i++;
+         b = (b - m->mask) & m->mask;
+      } while (b != 0);
+
+      if (size + i > table_size) my_fatal("magic_init(): table overflow\n");
+
+#if PEXT
+      if (UsePext) {
+
+         m->magic = 0;
+
+         for (index = 0; index < i; index++) {
+            table[size+BB_PEXT(occupancy[index],m->mask)] = reference[index];
+         }
+
+      } else
+#endif
+      {
+
+         // trial and error with sparse random numbers
+
+         seed = MagicSeed[sq_64>>3];
+
+         do {
+
+            do {
+               m->magic = magic_random(&seed) & magic_random(&seed) & magic_random(&seed);
+            } while (BB_COUNT((m->magic*m->mask)>>56) < 6);
+
+            epoch++;
+
+            for (index = 0; index < i; index++) {
+
+               b = (occupancy[index] * m->magic) >> m->shift;
+
+               if (age[b] < epoch) {
+                  age[b] = epoch;
+                  table[size+b] = reference[index];
+               } else if (table[size+b] != reference[index]) {
+                  break; // destructive collision
+               }
+            }
+
+         } while (index < i);
+      }
+
+      size += i;
+   }
+}
+
+// ray_attack()
+
+static uint64 ray_attack(int square, const inc_t inc[], uint64 occupied) {
+
+   int dir, to;
+   uint64 attack;
+
+   ASSERT(SQUARE_IS_OK(square));
+   ASSERT(inc!=NULL);
+
+   attack = 0;
+
+   for (dir = 0; inc[dir] != IncNone; dir++) {
+      for (to = square+inc[dir]; SQUARE_IS_OK(to); to += inc[dir]) {
+         attack |= SQUARE_BIT(to);
+         if ((occupied & SQUARE_BIT(to)) != 0) break;
+      }
+   }
+
+   return attack;
+}
+
+// magic_random()
+
+static uint64 magic_random(uint64 * seed) {
+
+   ASSERT(seed!=NULL);
+
+   // xorshift64*
+
+   *seed ^= *seed >> 12;
+   *seed ^= *seed << 25;
+   *seed ^= *seed >> 27;
+
+   return *seed * U64(2685821657736338717);
+}
+
+// bitboard_pext()
+
+bool bitboard_pext() {
+
+   // BMI2 support, PEXT is slow on some CPUs (see the "attackbench" command)
+
+#if PEXT && defined(_MSC_VER)
+
+   int info[4];
+
+   __cpuidex(info,7,0);
+
+   return (info[1] & (1 << 8)) != 0;
+
+#elif PEXT
+
+   return __builtin_cpu_supports("bmi2") != 0;
+
+#else
+
+   return false;
+
+#endif
+}
+
+// bb_first()
+
+int bb_first(uint64 b) {
+
+   int n;
+
+   ASSERT(b!=0);
+
+   for (n = 0; (b & 1) == 0; n++) b >>= 1;
+
+   return n;
+}
+
+// bb_count()
+
+int bb_count(uint64 b) {
+
+   int n;
+
+   for (n = 0; b != 0; n++) b &= b - 1;
+
+   return n;
+}
+
+// slider_bench()
+
+uint64 slider_bench(int method, const uint64 occupied[], int size, int repeat, double * time) {
+
+   bool use_pext;
+   int r, i, sq_64;
+   uint64 b, check;
+
+   ASSERT(method==SliderRay||method==SliderMagic||method==SliderPext);
+   ASSERT(occupied!=NULL);
+   ASSERT(size>=0);
+   ASSERT(repeat>=0);
+   ASSERT(time!=NULL);
+
+   // the tables only hold one indexing scheme, rebuild them if needed
+
+   use_pext = UsePext;
+
+   if (method != SliderRay && UsePext != (method == SliderPext)) {
+      UsePext = (method == SliderPext);
+      magic_init(BishopMagic,BishopTable,BishopTableSize,BishopInc);
+      magic_init(RookMagic,RookTable,RookTableSize,RookInc);
+   }
+
+   // bishop and rook attacks from every square of every position
+
+   check = 0;
+   *time = now_real();
+
+   for (r = 0; r < repeat; r++) {
+      for (i = 0; i < size; i++) {
+         b = occupied[i];
+         if (method == SliderRay) {
+            for (sq_64 = 0; sq_64 < 64; sq_64++) {
+               check ^= ray_attack(SQUARE_FROM_64(sq_64),BishopInc,b) ^ ray_attack(SQUARE_FROM_64(sq_64),RookInc,b);
+            }
+         } else {
+            for (sq_64 = 0; sq_64 < 64; sq_64++) {
+               check ^= BISHOP_ATTACK(sq_64,b) ^ ROOK_ATTACK(sq_64,b);
+            }
+         }
+         check = (check << 1) | (check >> 63); // keep the order significant
+      }
+   }
+
+   *time = now_real() - *time;
+
+   if (UsePext != use_pext) {
+      UsePext = use_pext;
+      magic_init(BishopMagic,BishopTable,BishopTableSize,BishopInc);
+      magic_init(RookMagic,RookTable,RookTableSize,RookInc);
+   }
+
+   return check;
+}
+
+// end of bitboard.cpp
+
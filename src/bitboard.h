@@ -0,0 +1,117 @@
+
+// bitboard.h
+
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+// includes
+
+#include "colour.h"
+#include "square.h"
+#include "util.h"
+
+// defines
+
+#if (defined(__GNUC__) && defined(__x86_64__)) || (defined(_MSC_VER) && defined(_M_X64))
+#  define PEXT TRUE // BMI2 code is compiled in, and used only if the CPU has it
+#else
+#  define PEXT FALSE
+#endif
+
+#if PEXT && defined(_MSC_VER)
+#  include <immintrin.h>
+#endif
+
+// constants
+
+const int SliderRay   = 0; // methods compared by slider_bench()
+const int SliderMagic = 1;
+const int SliderPext  = 2;
+
+// macros
+
+#define SQUARE_BIT(square)        (SquareBit[square]) // 0 outside the board
+
+#define BETWEEN(square_1,square_2) (Between[SQUARE_TO_64(square_1)][SQUARE_TO_64(square_2)])
+
+#if defined(__GNUC__)
+#  define BB_FIRST(b)             (__builtin_ctzll(b))
+#  define BB_COUNT(b)             (__builtin_popcountll(b))
+#else
+#  define BB_FIRST(b)             (bb_first(b))
+#  define BB_COUNT(b)             (bb_count(b))
+#endif
+
+#define MAGIC_INDEX(m,occupied)   ((int)((((occupied)&(m)->mask)*(m)->magic)>>(m)->shift))
+
+#if PEXT && defined(__GNUC__)
+#  define BB_PEXT(b,mask)         (bb_pext((b),(mask)))
+#elif PEXT
+#  define BB_PEXT(b,mask)         ((int)_pext_u64((b),(mask)))
+#endif
+
+#if PEXT
+#  define MAGIC_ATTACK(m,occupied) ((m)->attack[UsePext?BB_PEXT((occupied),(m)->mask):MAGIC_INDEX((m),(occupied))])
+#else
+#  define MAGIC_ATTACK(m,occupied) ((m)->attack[MAGIC_INDEX((m),(occupied))])
+#endif
+
+#define BISHOP_ATTACK(sq_64,occupied) (MAGIC_ATTACK(&BishopMagic[sq_64],(occupied)))
+#define ROOK_ATTACK(sq_64,occupied)   (MAGIC_ATTACK(&RookMagic[sq_64],(occupied)))
+#define QUEEN_ATTACK(sq_64,occupied)  (BISHOP_ATTACK((sq_64),(occupied))|ROOK_ATTACK((sq_64),(occupied)))
+
+// types
+
+struct magic_t {
+   uint64 mask; // relevant occupancy, the edges are left out
+   uint64 magic;
+   const uint64 * attack;
+   int shift;
+};
+
+// variables
+
+extern uint64 SquareBit[SquareNb];
+
+extern uint64 PawnAttackBB[ColourNb][64];
+extern uint64 KnightAttackBB[64];
+extern uint64 KingAttackBB[64];
+
+extern uint64 Between[64][64];
+
+extern magic_t BishopMagic[64];
+extern magic_t RookMagic[64];
+
+extern bool UsePext;
+
+// functions
+
+extern void   bitboard_init ();
+extern bool   bitboard_pext ();
+
+extern int    bb_first      (uint64 b);
+extern int    bb_count      (uint64 b);
+
+extern uint64 slider_bench  (int method, const uint64 occupied[], int size, int repeat, double * time);
+
+// inline functions
+
+#if PEXT && defined(__GNUC__)
+
+static inline int bb_pext(uint64 b, uint64 mask) {
+
+   uint64 index;
+
+   // inline assembly, so that the rest of the program is not compiled with -mbmi2
+
+   __asm__ ("pextq %2, %1, %0" : "=r" (index) : "r" (b), "r" (mask));
+
+   return int(index);
+}
+
+#endif
+
+#endif // !defined BITBOARD_H
+
+// end of bitboard.h
+
@@ -4,6 +4,7 @@
 // includes
 
 #include "attack.h"
+#include "bitboard.h"
 #include "board.h"
 #include "colour.h"
 #include "fen.h"
@@ -24,6 +25,10 @@
 
 static const bool UseSlowDebug = false;
 
+// prototypes
+
+static void history_count (board_t * board);
+
 // functions
 
 // board_is_ok()
@@ -32,6 +37,7 @@ bool board_is_ok(const board_t * board) {
 
    int sq, piece, colour;
    int size, pos;
+   int sq_64, piece_12;
 
    if (board == NULL) return false;
 
@@ -150,12 +156,32 @@ bool board_is_ok(const board_t * board) {
    if (board->number[WhiteKing12] != 1) return false;
    if (board->number[BlackKing12] != 1) return false;
 
+   // bitboards
+
+   for (sq_64 = 0; sq_64 < 64; sq_64++) {
+
+      sq = SQUARE_FROM_64(sq_64);
+      piece = board->square[sq];
+
+      for (piece_12 = 0; piece_12 < 12; piece_12++) {
+         if (((board->piece_bb[piece_12] & SQUARE_BIT(sq)) != 0) != (piece != Empty && PIECE_TO_12(piece) == piece_12)) return false;
+      }
+
+      for (colour = 0; colour < ColourNb; colour++) {
+         if (((board->colour_bb[colour] & SQUARE_BIT(sq)) != 0) != COLOUR_IS(piece,colour)) return false;
+      }
+   }
+
+   if (board->occupied != (board->colour_bb[White] | board->colour_bb[Black])) return false;
+
    // misc
 
    if (!COLOUR_IS_OK(board->turn)) return false;
 
    if (board->ply_nb < 0) return false;
-   if (board->sp < board->ply_nb) return false;
+   if (board->history == NULL) return false;
+   if (board->sp < board->ply_nb || board->sp > StackSize) return false;
+   if (board->sp > 0 && board->history->count[REP_FILTER(board->history->key[board->sp-1])] == 0) return false;
 
    if (board->cap_sq != SquareNone && !SQUARE_IS_OK(board->cap_sq)) return false;
 
@@ -204,9 +230,33 @@ void board_copy(board_t * dst, const board_t * src) {
    ASSERT(dst!=NULL);
    ASSERT(board_is_ok(src));
 
+   // the key history is shared, only one of the boards may then be played on
+
    *dst = *src;
 }
 
+// board_fork()
+
+void board_fork(board_t * dst, const board_t * src, history_t * history) {
+
+   int i;
+
+   ASSERT(dst!=NULL);
+   ASSERT(board_is_ok(src));
+   ASSERT(history!=NULL);
+
+   *dst = *src;
+
+   // private key history, only the keys since the last irreversible move matter
+
+   dst->history = history;
+   dst->sp = src->ply_nb;
+
+   for (i = 0; i < src->ply_nb; i++) history->key[i] = src->history->key[src->sp-src->ply_nb+i]; // may overlap
+
+   history_count(dst);
+}
+
 // board_init_list()
 
 void board_init_list(board_t * board) {
@@ -343,6 +393,24 @@ void board_init_list(board_t * board) {
       if (board->piece_size[colour] + board->pawn_size[colour] > 16) my_fatal("board_init_list(): illegal position\n");
    }
 
+   // bitboards
+
+   for (piece = 0; piece < 12; piece++) board->piece_bb[piece] = 0;
+   for (colour = 0; colour < ColourNb; colour++) board->colour_bb[colour] = 0;
+
+   for (sq_64 = 0; sq_64 < 64; sq_64++) {
+
+      sq = SQUARE_FROM_64(sq_64);
+      piece = board->square[sq];
+
+      if (piece != Empty) {
+         board->piece_bb[PIECE_TO_12(piece)] |= SQUARE_BIT(sq);
+         board->colour_bb[PIECE_COLOUR(piece)] |= SQUARE_BIT(sq);
+      }
+   }
+
+   board->occupied = board->colour_bb[White] | board->colour_bb[Black];
+
    // last square
 
    board->cap_sq = SquareNone;
@@ -355,9 +423,14 @@ void board_init_list(board_t * board) {
 
    // hash key
 
-   for (i = 0; i < board->ply_nb; i++) board->stack[i] = 0; // HACK
+   ASSERT(board->history!=NULL);
+   ASSERT(board->ply_nb<StackSize);
+
+   for (i = 0; i < board->ply_nb; i++) board->history->key[i] = 0; // HACK
    board->sp = board->ply_nb;
 
+   history_count(board);
+
    board->key = hash_key(board);
    board->pawn_key = hash_pawn_key(board);
    board->material_key = hash_material_key(board);
@@ -448,11 +521,51 @@ bool board_is_repetition(const board_t * board) {
       return !board_is_mate(board);
    }
 
-   // position repetition
+   // position repetition, the scan is only needed when the filter has seen a similar key
+
+   if (board->history->count[REP_FILTER(board->key)] == 0) return false;
 
    ASSERT(board->sp>=board->ply_nb);
    for (i = 4; i <= board->ply_nb; i += 2) {
-       if (board->stack[board->sp-i] == board->key) return true;
+       if (board->history->key[board->sp-i] == board->key) return true;
+   }
+
+   return false;
+}
+
+// board_has_cycle()
+
+bool board_has_cycle(const board_t * board) {
+
+   int i, j, move;
+   int from, to;
+   uint64 key;
+
+   ASSERT(board!=NULL);
+
+   // can the side to move play a reversible move back to an earlier position?
+   // the key difference then matches a single piece move, see hash_init()
+
+   ASSERT(board->sp>=board->ply_nb);
+
+   for (i = 3; i <= board->ply_nb; i += 2) {
+
+      key = board->key ^ board->history->key[board->sp-i];
+
+      j = CUCKOO_1(key);
+      if (CuckooKey[j] != key) {
+         j = CUCKOO_2(key);
+         if (CuckooKey[j] != key) continue;
+      }
+
+      move = CuckooMove[j];
+      from = MOVE_FROM(move);
+      to = MOVE_TO(move);
+
+      if ((BETWEEN(from,to) & board->occupied) != 0) continue;
+
+      if (board->square[from] == Empty) from = to; // the moves both ways share the entry
+      if (COLOUR_IS(board->square[from],board->turn)) return true;
    }
 
    return false;
@@ -516,5 +629,18 @@ int board_endgame(const board_t * board) {
    return endgame;
 }
 
+// history_count()
+
+static void history_count(board_t * board) {
+
+   int i;
+
+   ASSERT(board!=NULL);
+   ASSERT(board->history!=NULL);
+
+   for (i = 0; i < RepFilterSize; i++) board->history->count[i] = 0;
+   for (i = 0; i < board->sp; i++) board->history->count[REP_FILTER(board->history->key[i])]++;
+}
+
 // end of board.cpp
 
@@ -37,19 +37,27 @@ const int FlagsBlackKingCastle  = 1 << 2;
 const int FlagsBlackQueenCastle = 1 << 3;
 
 const int StackSize = 4096;
+const int RepFilterSize = 1024; // power of two
 
 // macros
 
 #define KING_POS(board,colour) ((board)->piece[colour][0])
 
+#define REP_FILTER(key) ((int)(key)&(RepFilterSize-1))
+
 // types
 
-struct board_t {
+struct history_t { // key history, owned by a thread
+   uint64 key[StackSize];
+   uint16 count[RepFilterSize]; // keys in key[] by their low bits, see board_is_repetition()
+};
+
+struct board_t { // hot fields only, the key history lives outside (see board_copy())
 
    int piece_material[ColourNb]; // Thomas
      	
-   int square[SquareNb];
-   int pos[SquareNb];
+   uint8 square[SquareNb];
+   sint8 pos[SquareNb];
 
    sq_t piece[ColourNb][32]; // only 17 are needed
    int piece_size[ColourNb];
@@ -58,15 +66,19 @@ struct board_t {
    int pawn_size[ColourNb];
 
    int piece_nb;
-   int number[16]; // only 12 are needed
+   uint8 number[16]; // only 12 are needed
+
+   uint8 pawn_file[ColourNb][FileNb];
 
-   int pawn_file[ColourNb][FileNb];
+   uint64 piece_bb[12]; // by PIECE_TO_12(), see bitboard.h
+   uint64 colour_bb[ColourNb];
+   uint64 occupied;
 
    int turn;
    int flags;
    int ep_square;
    int ply_nb;
-   int sp; // TODO: MOVE ME?
+   int sp;
 
    int cap_sq;
 	int moving_piece;
@@ -78,7 +90,7 @@ struct board_t {
    uint64 pawn_key;
    uint64 material_key;
 
-   uint64 stack[StackSize];
+   history_t * history; // owned by the thread or borrowed from the source board
 };
 
 // functions
@@ -87,6 +99,7 @@ extern bool board_is_ok         (const board_t * board);
 
 extern void board_clear         (board_t * board);
 extern void board_copy          (board_t * dst, const board_t * src);
+extern void board_fork          (board_t * dst, const board_t * src, history_t * history);
 
 extern void board_init_list     (board_t * board);
 
@@ -96,6 +109,7 @@ extern bool board_is_mate       (const board_t * board);
 extern bool board_is_stalemate  (board_t * board);
 
 extern bool board_is_repetition (const board_t * board);
+extern bool board_has_cycle     (const board_t * board);
 
 extern int  board_material      (const board_t * board);
 extern int  board_opening       (const board_t * board);
@@ -4,17 +4,21 @@
 // includes
 
 #include <cstdlib> // for abs()
+#include <cstring>
 
 #include "attack.h"
+#include "bitboard.h"
 #include "board.h"
 #include "colour.h"
 #include "eval.h"
+#include "hash.h"
 #include "material.h"
 #include "move.h"
 #include "option.h"
 #include "pawn.h"
 #include "piece.h"
 #include "see.h"
+#include "thread.h"
 #include "util.h"
 #include "value.h"
 #include "vector.h"
@@ -23,7 +27,6 @@
 
 // macros
 
-#define THROUGH(piece) ((piece)==Empty)
 #define ABS(x) ((x)<0?-(x):(x))
 
 // constants and variables
@@ -206,6 +209,8 @@ static bool bishop_can_attack  (const board_t * board, int to, int colour);
 
 void eval_parameter() {
 
+   int ThreadId;
+
     // UCI options
 
    PieceActivityWeight = (option_get_int("Piece Activity") * 256 + 50) / 100;
@@ -215,6 +220,12 @@ void eval_parameter() {
    LazyEval = option_get_bool("Toga Lazy Eval"); /* Thomas */
    lazy_eval_cutoff = option_get_int("Toga Lazy Eval Margin");
    second_lazy_eval_cutoff = option_get_int("Toga Lazy Eval Mobility Margin");
+
+   // cached scores used the old weights
+
+   for (ThreadId = 0; ThreadId < MaxThreads; ThreadId++) {
+      if (Thread[ThreadId] != NULL) eval_clear(ThreadId);
+   }
 }
 
 // eval_init()
@@ -353,10 +364,83 @@ void eval_init() {
    KingAttackUnit[BQ] = 4;
 }
 
+// eval_alloc()
+
+void eval_alloc(int ThreadId) {
+
+   eval_cache_t * cache;
+   uint64 target, size;
+
+   ASSERT(sizeof(eval_entry_t)==8);
+
+   // called by the owning thread, eval_clear() touches the table first
+
+   cache = Thread[ThreadId]->eval_cache;
+
+   target = uint64(option_get_int("Eval Cache")) * 1024 * 1024 / sizeof(eval_entry_t);
+   for (size = 1; size * 2 <= target; size *= 2)
+      ;
+
+   cache->table = NULL;
+   cache->size = 0;
+   cache->mask = 0;
+
+   if (target != 0) {
+      cache->size = uint32(size);
+      cache->mask = uint32(size) - 1;
+      cache->table = (eval_entry_t *) my_malloc(size*sizeof(eval_entry_t));
+   }
+
+   eval_clear(ThreadId);
+}
+
+// eval_free()
+
+void eval_free(int ThreadId) {
+
+   if (Thread[ThreadId]->eval_cache->table != NULL) {
+      my_free(Thread[ThreadId]->eval_cache->table);
+      Thread[ThreadId]->eval_cache->table = NULL;
+   }
+}
+
+// eval_clear()
+
+void eval_clear(int ThreadId) {
+
+   if (Thread[ThreadId]->eval_cache->table != NULL) {
+      memset(Thread[ThreadId]->eval_cache->table,0,Thread[ThreadId]->eval_cache->size*sizeof(eval_entry_t));
+   }
+
+   Thread[ThreadId]->eval_cache->read_nb = 0;
+   Thread[ThreadId]->eval_cache->read_hit = 0;
+}
+
+// eval_hits()
+
+void eval_hits(sint64 * read_nb, sint64 * read_hit) {
+
+   int ThreadId;
+
+   ASSERT(read_nb!=NULL);
+   ASSERT(read_hit!=NULL);
+
+   *read_nb = 0;
+   *read_hit = 0;
+
+   for (ThreadId = 0; ThreadId < NumberThreads; ThreadId++) {
+      if (Thread[ThreadId] == NULL) continue;
+      *read_nb += Thread[ThreadId]->eval_cache->read_nb;
+      *read_hit += Thread[ThreadId]->eval_cache->read_hit;
+   }
+}
+
 // eval()
 
 int eval(board_t * board, int alpha, int beta, int ThreadId) {
 
+   eval_cache_t * cache;
+   eval_entry_t * entry;
    int opening, endgame;
    material_info_t mat_info[1];
    pawn_info_t pawn_info[1];
@@ -371,6 +455,23 @@ int eval(board_t * board, int alpha, int beta, int ThreadId) {
    ASSERT(board_is_legal(board));
    ASSERT(!board_is_check(board)); // fixed by adding in_check condition to razoring (JD)
 
+   // eval cache, only complete evaluations are stored (not the lazy ones below)
+
+   cache = Thread[ThreadId]->eval_cache;
+   entry = NULL;
+
+   if (cache->table != NULL) {
+
+      cache->read_nb++;
+
+      entry = &cache->table[KEY_INDEX(board->key)&cache->mask];
+
+      if (entry->lock == KEY_LOCK(board->key)) {
+         cache->read_hit++;
+         return entry->value;
+      }
+   }
+
    // init
 
    opening = 0;
@@ -393,6 +494,10 @@ int eval(board_t * board, int alpha, int beta, int ThreadId) {
    opening += board->opening;
    endgame += board->endgame;
 
+   // pawns, needed by the draw recognisers below (the score is added later)
+
+   pawn_get_info(pawn_info,board,ThreadId);
+
    // draw
 
    eval_draw(board,mat_info,pawn_info,mul);
@@ -433,8 +538,6 @@ int eval(board_t * board, int alpha, int beta, int ThreadId) {
    
    // pawns (moved JD: very small gain)
 
-   pawn_get_info(pawn_info,board,ThreadId);
-
    opening += pawn_info->opening;
    endgame += pawn_info->endgame;
 
@@ -502,6 +605,13 @@ int eval(board_t * board, int alpha, int beta, int ThreadId) {
 
    ASSERT(!value_is_mate(eval));
 
+   // store
+
+   if (entry != NULL) {
+      entry->lock = KEY_LOCK(board->key);
+      entry->value = eval;
+   }
+
    return eval;
 }
 
@@ -752,7 +862,7 @@ static void eval_piece(const board_t * board, const material_info_t * mat_info,
    int me, opp;
    int opp_flag;
    const sq_t * ptr;
-   int from, to;
+   int from;
    int piece;
    int mob;
    int capture;
@@ -764,6 +874,7 @@ static void eval_piece(const board_t * board, const material_info_t * mat_info,
    int piece_nb, attackvalue;
    int king_rank,piece_rank,new_mob, piece_file;
    int att_value;
+   uint64 attack, b;
 
    ASSERT(board!=NULL);
    ASSERT(mat_info!=NULL);
@@ -901,23 +1012,15 @@ static void eval_piece(const board_t * board, const material_info_t * mat_info,
 
             // mobility
 
-            mob = 0;
-            
-            for (to = from-17; capture=board->square[to], THROUGH(capture); to -= 17) mob += MobMove;
-           	mob += unit[capture];
-           	att_value += attack_unit[capture];
-
-            for (to = from-15; capture=board->square[to], THROUGH(capture); to -= 15) mob += MobMove;
-            mob += unit[capture];
-            att_value += attack_unit[capture];
+            attack = BISHOP_ATTACK(SQUARE_TO_64(from),board->occupied);
 
-            for (to = from+15; capture=board->square[to], THROUGH(capture); to += 15) mob += MobMove;
-           	mob += unit[capture];
-           	att_value += attack_unit[capture];
+            mob = MobMove * BB_COUNT(attack&~board->occupied);
 
-            for (to = from+17; capture=board->square[to], THROUGH(capture); to += 17) mob += MobMove;
-            mob += unit[capture];
-            att_value += attack_unit[capture];
+            for (b = attack & board->occupied; b != 0; b &= b - 1) { // the edge counts for nothing
+               capture = board->square[SQUARE_FROM_64(BB_FIRST(b))];
+               mob += unit[capture];
+               att_value += attack_unit[capture];
+            }
 
             op[me] += bishop_mob_opening[mob];
             eg[me] += bishop_mob_endgame[mob];
@@ -943,23 +1046,15 @@ static void eval_piece(const board_t * board, const material_info_t * mat_info,
 
             // mobility
 
-            mob = 0;
-
-            for (to = from-16; capture=board->square[to], THROUGH(capture); to -= 16) mob += MobMove;
-            mob += unit[capture];
-            att_value += attack_unit[capture];
-
-            for (to = from- 1; capture=board->square[to], THROUGH(capture); to -=  1) mob += MobMove;
-            mob += unit[capture];
-            att_value += attack_unit[capture];
+            attack = ROOK_ATTACK(SQUARE_TO_64(from),board->occupied);
 
-            for (to = from+ 1; capture=board->square[to], THROUGH(capture); to +=  1) mob += MobMove;
-            mob += unit[capture];
-            att_value += attack_unit[capture];
+            mob = MobMove * BB_COUNT(attack&~board->occupied);
 
-            for (to = from+16; capture=board->square[to], THROUGH(capture); to += 16) mob += MobMove;
-            mob += unit[capture];
-            att_value += attack_unit[capture];
+            for (b = attack & board->occupied; b != 0; b &= b - 1) { // the edge counts for nothing
+               capture = board->square[SQUARE_FROM_64(BB_FIRST(b))];
+               mob += unit[capture];
+               att_value += attack_unit[capture];
+            }
 
             op[me] += rook_mob_opening[mob];
             eg[me] += rook_mob_endgame[mob];
@@ -1026,39 +1121,15 @@ static void eval_piece(const board_t * board, const material_info_t * mat_info,
 
          case Queen64:
          	
-         	mob = 0;
-         	
-         	for (to = from-17; capture=board->square[to], THROUGH(capture); to -= 17) mob += MobMove;
-            mob += unit[capture];
-            att_value += attack_unit[capture];
-
-            for (to = from-16; capture=board->square[to], THROUGH(capture); to -= 16) mob += MobMove;
-            mob += unit[capture];
-            att_value += attack_unit[capture];
-
-            for (to = from-15; capture=board->square[to], THROUGH(capture); to -= 15) mob += MobMove;
-            mob += unit[capture];
-            att_value += attack_unit[capture];
+            attack = QUEEN_ATTACK(SQUARE_TO_64(from),board->occupied);
 
-            for (to = from- 1; capture=board->square[to], THROUGH(capture); to -=  1) mob += MobMove;
-            mob += unit[capture];
-            att_value += attack_unit[capture];
+            mob = MobMove * BB_COUNT(attack&~board->occupied);
 
-            for (to = from+ 1; capture=board->square[to], THROUGH(capture); to +=  1) mob += MobMove;
-            mob += unit[capture];
-            att_value += attack_unit[capture];
-
-            for (to = from+15; capture=board->square[to], THROUGH(capture); to += 15) mob += MobMove;
-            mob += unit[capture];
-            att_value += attack_unit[capture];
-
-            for (to = from+16; capture=board->square[to], THROUGH(capture); to += 16) mob += MobMove;
-            mob += unit[capture];
-            att_value += attack_unit[capture];
-
-            for (to = from+17; capture=board->square[to], THROUGH(capture); to += 17) mob += MobMove;
-            mob += unit[capture];
-            att_value += attack_unit[capture];
+            for (b = attack & board->occupied; b != 0; b &= b - 1) { // the edge counts for nothing
+               capture = board->square[SQUARE_FROM_64(BB_FIRST(b))];
+               mob += unit[capture];
+               att_value += attack_unit[capture];
+            }
             
             op[me] += queen_mob_opening[mob];
             eg[me] += queen_mob_endgame[mob];
@@ -11,11 +11,31 @@
 
 //extern bool egbb_is_loaded;
 
+// types
+
+struct eval_entry_t {
+   uint32 lock;
+   sint32 value; // complete evaluation, from the side to move's point of view
+};
+
+struct eval_cache_t {
+   eval_entry_t * table; // NULL when disabled
+   uint32 size;
+   uint32 mask;
+   sint64 read_nb;
+   sint64 read_hit;
+};
+
 // functions
 
 extern void eval_init ();
 extern void eval_parameter ();
 
+extern void eval_alloc     (int ThreadId);
+extern void eval_free      (int ThreadId);
+extern void eval_clear     (int ThreadId);
+extern void eval_hits      (sint64 * read_nb, sint64 * read_hit);
+
 extern int  eval      (board_t * board, int alpha, int beta, int ThreadId);
 
 #endif // !defined EVAL_H
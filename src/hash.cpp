@@ -3,8 +3,10 @@
 
 // includes
 
+#include "attack.h"
 #include "board.h"
 #include "hash.h"
+#include "move.h"
 #include "piece.h"
 #include "random.h"
 #include "square.h"
@@ -14,8 +16,14 @@
 
 uint64 Castle64[16];
 
+uint64 CuckooKey[CuckooSize];
+uint16 CuckooMove[CuckooSize];
+
 // prototypes
 
+static void   cuckoo_init      ();
+static void   cuckoo_insert    (uint64 key, int move);
+
 static uint64 hash_counter_key (int piece_12, int count);
 
 // functions
@@ -27,6 +35,8 @@ void hash_init() {
    int i;
 
    for (i = 0; i < 16; i++) Castle64[i] = hash_castle_key(i);
+
+   cuckoo_init();
 }
 
 // hash_key()
@@ -193,5 +203,72 @@ static uint64 hash_counter_key(int piece_12, int count) {
    return key;
 }
 
+// cuckoo_init()
+
+static void cuckoo_init() {
+
+   int piece_12, piece;
+   int from_64, to_64, from, to;
+   int count;
+
+   // keys of all the piece moves on an empty board, for board_has_cycle()
+
+   for (count = 0; count < CuckooSize; count++) {
+      CuckooKey[count] = 0;
+      CuckooMove[count] = MoveNone;
+   }
+
+   count = 0;
+
+   for (piece_12 = WhiteKnight12; piece_12 < 12; piece_12++) {
+
+      piece = piece_from_12(piece_12);
+
+      for (from_64 = 0; from_64 < 64; from_64++) {
+         for (to_64 = from_64+1; to_64 < 64; to_64++) {
+
+            from = SQUARE_FROM_64(from_64);
+            to = SQUARE_FROM_64(to_64);
+
+            if (!PSEUDO_ATTACK(piece,to-from)) continue;
+
+            cuckoo_insert(hash_piece_key(piece,from)^hash_piece_key(piece,to)^RANDOM_64(RandomTurn),MOVE_MAKE(from,to));
+            count++;
+         }
+      }
+   }
+
+   ASSERT(count==3668);
+}
+
+// cuckoo_insert()
+
+static void cuckoo_insert(uint64 key, int move) {
+
+   int i, tmp;
+   uint64 tmp_key;
+
+   ASSERT(move!=MoveNone);
+
+   // kick out the occupant to its other slot until a free one is found
+
+   i = CUCKOO_1(key);
+
+   while (true) {
+
+      tmp_key = CuckooKey[i];
+      CuckooKey[i] = key;
+      key = tmp_key;
+
+      tmp = CuckooMove[i];
+      CuckooMove[i] = move;
+      move = tmp;
+
+      if (move == MoveNone) break;
+
+      i = (i == CUCKOO_1(key)) ? CUCKOO_2(key) : CUCKOO_1(key);
+   }
+}
+
 // end of hash.cpp
 
@@ -14,6 +14,9 @@
 #define KEY_INDEX(key) ((uint32)(key))
 #define KEY_LOCK(key)  ((uint32)((key)>>32))
 
+#define CUCKOO_1(key)  ((int)(key)&(CuckooSize-1))
+#define CUCKOO_2(key)  ((int)((key)>>16)&(CuckooSize-1))
+
 // constants
 
 const int RandomPiece     =   0; // 12 * 64
@@ -21,10 +24,15 @@ const int RandomCastle    = 768; // 4
 const int RandomEnPassant = 772; // 8
 const int RandomTurn      = 780; // 1
 
+const int CuckooSize = 8192; // power of two, holds the 3668 reversible moves
+
 // variables
 
 extern uint64 Castle64[16];
 
+extern uint64 CuckooKey[CuckooSize];
+extern uint16 CuckooMove[CuckooSize];
+
 // functions
 
 extern void   hash_init         ();
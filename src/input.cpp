@@ -0,0 +1,223 @@
+
+// input.cpp
+
+// includes
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <errno.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+
+#include "input.h"
+#include "search.h"
+#include "util.h"
+
+// constants
+
+static const int QueueSize = 256; // lines, a power of two
+static const int LineSize = 65536;
+
+// macros
+
+#ifdef _WIN32
+#  define MEMORY_BARRIER() MemoryBarrier()
+#else
+#  define MEMORY_BARRIER() __sync_synchronize()
+#endif
+
+// types
+
+struct queue_t { // single producer (the reader thread), single consumer (the main thread)
+   char * line[QueueSize]; // NULL = end of input
+   volatile int head; // next line to get, written by the consumer only
+   volatile int tail; // next free slot, written by the producer only
+#ifdef _WIN32
+   CRITICAL_SECTION lock;
+   CONDITION_VARIABLE change;
+   HANDLE reader;
+#else
+   pthread_mutex_t lock;
+   pthread_cond_t change;
+   pthread_t reader;
+#endif
+};
+
+// variables
+
+static queue_t Queue[1];
+
+// prototypes
+
+static void queue_wait  ();
+static void queue_wake  ();
+
+static void reader_loop ();
+
+#ifdef _WIN32
+static unsigned __stdcall reader_thread (void * param);
+#else
+static void * reader_thread (void * param);
+#endif
+
+// functions
+
+// input_init()
+
+void input_init() {
+
+   // from now on stdin belongs to the reader thread
+
+   Queue->head = 0;
+   Queue->tail = 0;
+
+#ifdef _WIN32
+   InitializeCriticalSection(&Queue->lock);
+   InitializeConditionVariable(&Queue->change);
+   Queue->reader = (HANDLE) _beginthreadex(NULL,0,&reader_thread,NULL,0,NULL);
+   if (Queue->reader == 0) my_fatal("input_init(): _beginthreadex(): failed\n");
+#else
+   pthread_mutex_init(&Queue->lock,NULL);
+   pthread_cond_init(&Queue->change,NULL);
+   if (pthread_create(&Queue->reader,NULL,reader_thread,NULL) != 0) {
+      my_fatal("input_init(): pthread_create(): %s\n",strerror(errno));
+   }
+#endif
+}
+
+// input_available()
+
+bool input_available() {
+
+   // no system call, cheap enough for the search to poll
+
+   return Queue->head != Queue->tail;
+}
+
+// input_get()
+
+bool input_get(char string[], int size) {
+
+   char * line;
+
+   ASSERT(string!=NULL);
+   ASSERT(size>=LineSize);
+
+   while (!input_available()) queue_wait();
+
+   MEMORY_BARRIER(); // the line was written before the tail
+
+   line = Queue->line[Queue->head];
+
+   MEMORY_BARRIER(); // read before the slot is handed back
+
+   Queue->head = (Queue->head + 1) & (QueueSize - 1);
+   queue_wake(); // the reader may be waiting for a free slot
+
+   if (line == NULL) return false; // EOF
+
+   strcpy(string,line);
+   my_free(line);
+
+   return true;
+}
+
+// queue_wait()
+
+static void queue_wait() {
+
+   int head, tail;
+
+   // sleeps until the other side moves, the caller checks its condition again
+
+   head = Queue->head;
+   tail = Queue->tail;
+
+#ifdef _WIN32
+   EnterCriticalSection(&Queue->lock);
+   if (Queue->head == head && Queue->tail == tail) SleepConditionVariableCS(&Queue->change,&Queue->lock,INFINITE);
+   LeaveCriticalSection(&Queue->lock);
+#else
+   pthread_mutex_lock(&Queue->lock);
+   if (Queue->head == head && Queue->tail == tail) pthread_cond_wait(&Queue->change,&Queue->lock);
+   pthread_mutex_unlock(&Queue->lock);
+#endif
+}
+
+// queue_wake()
+
+static void queue_wake() {
+
+#ifdef _WIN32
+   EnterCriticalSection(&Queue->lock);
+   WakeAllConditionVariable(&Queue->change);
+   LeaveCriticalSection(&Queue->lock);
+#else
+   pthread_mutex_lock(&Queue->lock);
+   pthread_cond_broadcast(&Queue->change);
+   pthread_mutex_unlock(&Queue->lock);
+#endif
+}
+
+// reader_loop()
+
+static void reader_loop() {
+
+   char string[LineSize];
+   char * line;
+   int tail;
+
+   do {
+
+      // read a line, blocking
+
+      if (my_file_read_line(stdin,string,LineSize)) {
+         line = my_strdup(string);
+      } else {
+         line = NULL; // EOF, the last entry
+      }
+
+      // queue it, waiting for a free slot if needed
+
+      tail = Queue->tail;
+      while (((tail + 1) & (QueueSize - 1)) == Queue->head) queue_wait();
+
+      Queue->line[tail] = line;
+
+      MEMORY_BARRIER(); // the line is visible before the tail
+
+      Queue->tail = (tail + 1) & (QueueSize - 1);
+      queue_wake();
+
+      // a searching main thread looks at the queue at its next node, see search_check()
+
+      SearchInfo[0]->poll = true;
+
+   } while (line != NULL);
+}
+
+// reader_thread()
+
+#ifdef _WIN32
+static unsigned __stdcall reader_thread(void * param) {
+
+   reader_loop();
+
+   return 0;
+}
+#else
+static void * reader_thread(void * param) {
+
+   reader_loop();
+
+   return NULL;
+}
+#endif
+
+// end of input.cpp
+
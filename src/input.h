@@ -0,0 +1,21 @@
+
+// input.h
+
+#ifndef INPUT_H
+#define INPUT_H
+
+// includes
+
+#include "util.h"
+
+// functions
+
+extern void input_init      ();
+
+extern bool input_available ();
+extern bool input_get       (char string[], int size);
+
+#endif // !defined INPUT_H
+
+// end of input.h
+
@@ -7,6 +7,7 @@
 #include <cstdlib>
 
 #include "attack.h"
+#include "bitboard.h"
 #include "book.h"
 #include "hash.h"
 #include "move_do.h"
@@ -16,6 +17,7 @@
 #include "protocol.h"
 #include "random.h"
 #include "square.h"
+#include "thread.h"
 #include "trans.h"
 #include "util.h"
 #include "value.h"
@@ -41,6 +43,7 @@ int main(int argc, char * argv[]) {
 
    square_init();
    piece_init();
+   bitboard_init();
    pawn_init_bit();
    value_init();
    vector_init();
@@ -50,10 +53,18 @@ int main(int argc, char * argv[]) {
    random_init();
    
    trans_init(Trans);
+   thread_alloc(0);
    hash_init();
    
    book_init();
 
+   // command-line benchmark
+
+   if (argc >= 2 && my_string_equal(argv[1],"bench")) {
+      bench(argc-1,argv+1);
+      return EXIT_SUCCESS;
+   }
+
    // loop
 
    loop();
@@ -13,6 +13,7 @@
 #include "piece.h"
 #include "protocol.h"
 #include "square.h"
+#include "thread.h"
 #include "util.h"
 #include "search.h"
 
@@ -59,21 +60,6 @@ static /* const */ int RookPawnPenalty = 10;
 
 typedef material_info_t entry_t;
 
-struct material_t {
-   entry_t * table;
-   uint32 size;
-   uint32 mask;
-   uint32 used;
-   sint64 read_nb;
-   sint64 read_hit;
-   sint64 write_nb;
-   sint64 write_collision;
-};
-
-// variables
-
-static material_t Material[MaxThreads][1];
-
 // prototypes
 
 static void material_comp_info (material_info_t * info, const board_t * board);
@@ -98,54 +84,38 @@ void material_parameter() {
 
 void material_init() {
 
-	int ThreadId;
-
    // UCI options
 
    material_parameter();
-
-   // material table
-
-	for (ThreadId = 0; ThreadId < NumberThreads; ThreadId++){
-		Material[ThreadId]->size = 0;
-		Material[ThreadId]->mask = 0;
-		Material[ThreadId]->table = NULL;
-	}
 }
 
 // material_alloc()
 
-void material_alloc() {
-
-	int ThreadId;
+void material_alloc(int ThreadId) {
 
    ASSERT(sizeof(entry_t)==16);
 
+   // called by the owning thread, material_clear() touches the table first
+
    if (UseTable) {
 
-		for (ThreadId = 0; ThreadId < NumberThreads; ThreadId++){
-			Material[ThreadId]->size = TableSize;
-			Material[ThreadId]->mask = TableSize - 1;
-			Material[ThreadId]->table = (entry_t *) my_malloc((uint64) Material[ThreadId]->size*sizeof(entry_t));
+      Thread[ThreadId]->material->size = TableSize;
+      Thread[ThreadId]->material->mask = TableSize - 1;
+      Thread[ThreadId]->material->table = (entry_t *) my_malloc((uint64) Thread[ThreadId]->material->size*sizeof(entry_t));
 
-			material_clear(ThreadId);
-		}
+      material_clear(ThreadId);
    }
 }
 
 // material_free()
 
-void material_free() {
-
-	int ThreadId;
+void material_free(int ThreadId) {
 
    ASSERT(sizeof(entry_t)==16);
 
    if (UseTable) {
-
-		for (ThreadId = 0; ThreadId < NumberThreads; ThreadId++){
-		  my_free(Material[ThreadId]->table);
-		}
+      my_free(Thread[ThreadId]->material->table);
+      Thread[ThreadId]->material->table = NULL;
    }
 }
 
@@ -153,15 +123,22 @@ void material_free() {
 
 void material_clear(int ThreadId) {
 
-   if (Material[ThreadId]->table != NULL) {
-      memset(Material[ThreadId]->table,0,Material[ThreadId]->size*sizeof(entry_t));
+   if (Thread[ThreadId]->material->table != NULL) {
+      memset(Thread[ThreadId]->material->table,0,Thread[ThreadId]->material->size*sizeof(entry_t));
    }
 
-   Material[ThreadId]->used = 0;
-   Material[ThreadId]->read_nb = 0;
-   Material[ThreadId]->read_hit = 0;
-   Material[ThreadId]->write_nb = 0;
-   Material[ThreadId]->write_collision = 0;
+   Thread[ThreadId]->material->used = 0;
+   Thread[ThreadId]->material->read_nb = 0;
+   Thread[ThreadId]->material->read_hit = 0;
+   Thread[ThreadId]->material->write_nb = 0;
+   Thread[ThreadId]->material->write_collision = 0;
+}
+
+// material_prefetch()
+
+void material_prefetch(uint64 key, int ThreadId) {
+
+   if (UseTable) PREFETCH(&Thread[ThreadId]->material->table[KEY_INDEX(key)&Thread[ThreadId]->material->mask]);
 }
 
 // material_get_info()
@@ -178,16 +155,16 @@ void material_get_info(material_info_t * info, const board_t * board, int Thread
 
    if (UseTable) {
 
-      Material[ThreadId]->read_nb++;
+      Thread[ThreadId]->material->read_nb++;
 
       key = board->material_key;
-      entry = &Material[ThreadId]->table[KEY_INDEX(key)&Material[ThreadId]->mask];
+      entry = &Thread[ThreadId]->material->table[KEY_INDEX(key)&Thread[ThreadId]->material->mask];
 
       if (entry->lock == KEY_LOCK(key)) {
 
          // found
 
-         Material[ThreadId]->read_hit++;
+         Thread[ThreadId]->material->read_hit++;
 
          *info = *entry;
 
@@ -203,12 +180,12 @@ void material_get_info(material_info_t * info, const board_t * board, int Thread
 
    if (UseTable) {
 
-      Material[ThreadId]->write_nb++;
+      Thread[ThreadId]->material->write_nb++;
 
       if (entry->lock == 0) { // HACK: assume free entry
-         Material[ThreadId]->used++;
+         Thread[ThreadId]->material->used++;
       } else {
-         Material[ThreadId]->write_collision++;
+         Thread[ThreadId]->material->write_collision++;
       }
 
       *entry = *info;
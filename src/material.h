@@ -51,16 +51,28 @@ struct material_info_t {
    //sint16 pv[ColourNb]; /* Material without pawn and king */
 };
 
+struct material_t {
+   material_info_t * table;
+   uint32 size;
+   uint32 mask;
+   uint32 used;
+   sint64 read_nb;
+   sint64 read_hit;
+   sint64 write_nb;
+   sint64 write_collision;
+};
+
 // functions
 
 extern void material_init     ();
 extern void material_parameter();
 
-extern void material_alloc    ();
-extern void material_free    ();
+extern void material_alloc    (int ThreadId);
+extern void material_free     (int ThreadId);
 extern void material_clear    (int ThreadId);
 
 extern void material_get_info (material_info_t * info, const board_t * board, int ThreadId);
+extern void material_prefetch (uint64 key, int ThreadId);
 
 #endif // !defined MATERIAL_H
 
@@ -23,7 +23,7 @@ static void add_castle_checks     (list_t * list, board_t * board);
 
 static void add_check             (list_t * list, int move, board_t * board);
 
-static void find_pins             (int list[], const board_t * board);
+static void find_pins             (sq_t list[], const board_t * board);
 
 // functions
 
@@ -59,7 +59,7 @@ static void add_quiet_checks(list_t * list, const board_t * board) {
    int inc;
    int pawn;
    int rank;
-   int pin[8+1];
+   sq_t pin[8+1];
 
    ASSERT(list!=NULL);
    ASSERT(board!=NULL);
@@ -322,7 +322,7 @@ bool move_is_check(int move, board_t * board) {
 
 // find_pins()
 
-static void find_pins(int list[], const board_t * board) {
+static void find_pins(sq_t list[], const board_t * board) {
 
    int me, opp;
    int king;
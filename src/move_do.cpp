@@ -4,6 +4,7 @@
 // includes
 
 #include "attack.h"
+#include "bitboard.h"
 #include "board.h"
 #include "colour.h"
 #include "hash.h"
@@ -26,6 +27,13 @@ static void square_clear (board_t * board, int square, int piece, bool update);
 static void square_set   (board_t * board, int square, int piece, int pos, bool update);
 static void square_move  (board_t * board, int from, int to, int piece, bool update);
 
+static void key_push     (board_t * board);
+static void key_pop      (board_t * board);
+
+#if SNAPSHOT_UNDO
+static bool board_same   (const board_t * board_1, const board_t * board_2);
+#endif
+
 // functions
 
 // move_do_init()
@@ -69,6 +77,10 @@ void move_do(board_t * board, int move, undo_t * undo) {
 
    // initialise undo
 
+#if SNAPSHOT_UNDO
+   board_copy(undo->board,board);
+#endif
+
    undo->capture = false;
 
    undo->turn = board->turn;
@@ -100,8 +112,7 @@ void move_do(board_t * board, int move, undo_t * undo) {
 
    // update key stack
 
-   ASSERT(board->sp<StackSize);
-   board->stack[board->sp++] = board->key;
+   key_push(board);
 
    // update turn
 
@@ -306,15 +317,140 @@ void move_undo(board_t * board, int move, const undo_t * undo) {
 
    // update key stack
 
-   ASSERT(board->sp>0);
-   board->sp--;
+   key_pop(board);
 
    // debug
 
+#if SNAPSHOT_UNDO
+   if (!board_same(board,undo->board)) my_fatal("move_undo(): the unmake differs from the position before the move\n");
+#endif
+
    ASSERT(board_is_ok(board));
    ASSERT(board_is_legal(board));
 }
 
+// move_do_key()
+
+void move_do_key(const board_t * board, int move, uint64 * key, uint64 * pawn_key, uint64 * material_key) {
+
+   int me, opp;
+   int from, to;
+   int piece, capture, promote;
+   int piece_12;
+   int delta;
+   int sq;
+   int pawn;
+   uint64 hash_xor;
+
+   ASSERT(board!=NULL);
+   ASSERT(move_is_ok(move));
+   ASSERT(key!=NULL);
+   ASSERT(pawn_key!=NULL);
+   ASSERT(material_key!=NULL);
+
+   // predicts the keys move_do() would produce, without touching the board
+
+   *key = board->key;
+   *pawn_key = board->pawn_key;
+   *material_key = board->material_key;
+
+   me = board->turn;
+   opp = COLOUR_OPP(me);
+
+   from = MOVE_FROM(move);
+   to = MOVE_TO(move);
+
+   piece = board->square[from];
+   ASSERT(COLOUR_IS(piece,me));
+
+   // turn
+
+   *key ^= RANDOM_64(RandomTurn);
+
+   // castling rights
+
+   *key ^= Castle64[board->flags^(board->flags&CastleMask[from]&CastleMask[to])]; // HACK
+
+   // en-passant square
+
+   if ((sq=board->ep_square) != SquareNone) {
+      *key ^= RANDOM_64(RandomEnPassant+SQUARE_FILE(sq)-FileA);
+   }
+
+   if (PIECE_IS_PAWN(piece)) {
+
+      delta = to - from;
+
+      if (delta == +32 || delta == -32) {
+         pawn = PAWN_MAKE(opp);
+         if (board->square[to-1] == pawn || board->square[to+1] == pawn) {
+            *key ^= RANDOM_64(RandomEnPassant+SQUARE_FILE(to)-FileA);
+         }
+      }
+   }
+
+   // captured piece
+
+   sq = to;
+   if (MOVE_IS_EN_PASSANT(move)) sq = SQUARE_EP_DUAL(sq);
+
+   if ((capture=board->square[sq]) != Empty) {
+
+      piece_12 = PIECE_TO_12(capture);
+      hash_xor = RANDOM_64(RandomPiece+(piece_12^1)*64+SQUARE_TO_64(sq)); // HACK: ^1 for PolyGlot book
+
+      *key ^= hash_xor;
+      if (PIECE_IS_PAWN(capture)) *pawn_key ^= hash_xor;
+
+      *material_key ^= RANDOM_64(piece_12*16+(board->number[piece_12]-1));
+   }
+
+   // moving piece
+
+   piece_12 = PIECE_TO_12(piece);
+   hash_xor = RANDOM_64(RandomPiece+(piece_12^1)*64+SQUARE_TO_64(from));
+
+   *key ^= hash_xor;
+   if (PIECE_IS_PAWN(piece)) *pawn_key ^= hash_xor;
+
+   if (MOVE_IS_PROMOTE(move)) {
+
+      *material_key ^= RANDOM_64(piece_12*16+(board->number[piece_12]-1));
+
+      promote = move_promote(move);
+      piece_12 = PIECE_TO_12(promote);
+
+      *key ^= RANDOM_64(RandomPiece+(piece_12^1)*64+SQUARE_TO_64(to));
+      *material_key ^= RANDOM_64(piece_12*16+board->number[piece_12]);
+
+   } else {
+
+      hash_xor = RANDOM_64(RandomPiece+(piece_12^1)*64+SQUARE_TO_64(to));
+
+      *key ^= hash_xor;
+      if (PIECE_IS_PAWN(piece)) *pawn_key ^= hash_xor;
+   }
+
+   // castling rook
+
+   if (MOVE_IS_CASTLE(move)) {
+
+      piece_12 = PIECE_TO_12(Rook64|COLOUR_FLAG(me)); // HACK
+
+      if (to == G1) {
+         *key ^= RANDOM_64(RandomPiece+(piece_12^1)*64+SQUARE_TO_64(H1)) ^ RANDOM_64(RandomPiece+(piece_12^1)*64+SQUARE_TO_64(F1));
+      } else if (to == C1) {
+         *key ^= RANDOM_64(RandomPiece+(piece_12^1)*64+SQUARE_TO_64(A1)) ^ RANDOM_64(RandomPiece+(piece_12^1)*64+SQUARE_TO_64(D1));
+      } else if (to == G8) {
+         *key ^= RANDOM_64(RandomPiece+(piece_12^1)*64+SQUARE_TO_64(H8)) ^ RANDOM_64(RandomPiece+(piece_12^1)*64+SQUARE_TO_64(F8));
+      } else if (to == C8) {
+         *key ^= RANDOM_64(RandomPiece+(piece_12^1)*64+SQUARE_TO_64(A8)) ^ RANDOM_64(RandomPiece+(piece_12^1)*64+SQUARE_TO_64(D8));
+      } else {
+         ASSERT(false);
+      }
+   }
+}
+
 // move_do_null()
 
 void move_do_null(board_t * board, undo_t * undo) {
@@ -338,8 +474,7 @@ void move_do_null(board_t * board, undo_t * undo) {
 
    // update key stack
 
-   ASSERT(board->sp<StackSize);
-   board->stack[board->sp++] = board->key;
+   key_push(board);
 
    // update turn
 
@@ -389,8 +524,7 @@ void move_undo_null(board_t * board, const undo_t * undo) {
 
    // update key stack
 
-   ASSERT(board->sp>0);
-   board->sp--;
+   key_pop(board);
 
    // debug
 
@@ -405,7 +539,7 @@ static void square_clear(board_t * board, int square, int piece, bool update) {
    int sq;
    int i, size;
    int sq_64;
-   uint64 hash_xor;
+   uint64 hash_xor, bit;
 
    ASSERT(board!=NULL);
    ASSERT(SQUARE_IS_OK(square));
@@ -425,6 +559,14 @@ static void square_clear(board_t * board, int square, int piece, bool update) {
    ASSERT(board->square[square]==piece);
    board->square[square] = Empty;
 
+   // bitboards
+
+   bit = SQUARE_BIT(square);
+
+   board->piece_bb[piece_12] ^= bit;
+   board->colour_bb[colour] ^= bit;
+   board->occupied ^= bit;
+
    // piece list
 
    if (!PIECE_IS_PAWN(piece)) {
@@ -536,7 +678,7 @@ static void square_set(board_t * board, int square, int piece, int pos, bool upd
    int sq;
    int i, size;
    int sq_64;
-   uint64 hash_xor;
+   uint64 hash_xor, bit;
 
    ASSERT(board!=NULL);
    ASSERT(SQUARE_IS_OK(square));
@@ -554,6 +696,14 @@ static void square_set(board_t * board, int square, int piece, int pos, bool upd
    ASSERT(board->square[square]==Empty);
    board->square[square] = piece;
 
+   // bitboards
+
+   bit = SQUARE_BIT(square);
+
+   board->piece_bb[piece_12] ^= bit;
+   board->colour_bb[colour] ^= bit;
+   board->occupied ^= bit;
+
    // piece list
 
    if (!PIECE_IS_PAWN(piece)) {
@@ -670,7 +820,7 @@ static void square_move(board_t * board, int from, int to, int piece, bool updat
    int from_64, to_64;
    int piece_12;
    int piece_index;
-   uint64 hash_xor;
+   uint64 hash_xor, bit;
 
    ASSERT(board!=NULL);
    ASSERT(SQUARE_IS_OK(from));
@@ -681,6 +831,7 @@ static void square_move(board_t * board, int from, int to, int piece, bool updat
    // init
 
    colour = PIECE_COLOUR(piece);
+   piece_12 = PIECE_TO_12(piece);
 
    pos = board->pos[from];
    ASSERT(pos>=0);
@@ -701,6 +852,14 @@ static void square_move(board_t * board, int from, int to, int piece, bool updat
    ASSERT(board->pos[to]==-1);
    board->pos[to] = pos;
 
+   // bitboards
+
+   bit = SQUARE_BIT(from) | SQUARE_BIT(to);
+
+   board->piece_bb[piece_12] ^= bit;
+   board->colour_bb[colour] ^= bit;
+   board->occupied ^= bit;
+
    // piece list
 
    if (!PIECE_IS_PAWN(piece)) {
@@ -727,7 +886,6 @@ static void square_move(board_t * board, int from, int to, int piece, bool updat
 
       from_64 = SQUARE_TO_64(from);
       to_64 = SQUARE_TO_64(to);
-      piece_12 = PIECE_TO_12(piece);
 
       // PST
 
@@ -745,5 +903,101 @@ static void square_move(board_t * board, int from, int to, int piece, bool updat
    }
 }
 
+// key_push()
+
+static void key_push(board_t * board) {
+
+   ASSERT(board!=NULL);
+   ASSERT(board->sp<StackSize);
+
+   board->history->key[board->sp++] = board->key;
+   board->history->count[REP_FILTER(board->key)]++;
+}
+
+// key_pop()
+
+static void key_pop(board_t * board) {
+
+   ASSERT(board!=NULL);
+   ASSERT(board->sp>0);
+
+   board->sp--;
+
+   ASSERT(board->history->count[REP_FILTER(board->history->key[board->sp])]>0);
+   board->history->count[REP_FILTER(board->history->key[board->sp])]--;
+}
+
+// board_same()
+
+#if SNAPSHOT_UNDO
+
+static bool board_same(const board_t * board_1, const board_t * board_2) {
+
+   int colour, sq, i;
+
+   ASSERT(board_1!=NULL);
+   ASSERT(board_2!=NULL);
+
+   // field by field, the lists only up to their SquareNone end
+
+   for (sq = 0; sq < SquareNb; sq++) {
+      if (board_1->square[sq] != board_2->square[sq]) return false;
+      if (board_1->pos[sq] != board_2->pos[sq]) return false;
+   }
+
+   for (colour = 0; colour < ColourNb; colour++) {
+
+      if (board_1->piece_material[colour] != board_2->piece_material[colour]) return false;
+
+      if (board_1->piece_size[colour] != board_2->piece_size[colour]) return false;
+      for (i = 0; i <= board_1->piece_size[colour]; i++) {
+         if (board_1->piece[colour][i] != board_2->piece[colour][i]) return false;
+      }
+
+      if (board_1->pawn_size[colour] != board_2->pawn_size[colour]) return false;
+      for (i = 0; i <= board_1->pawn_size[colour]; i++) {
+         if (board_1->pawn[colour][i] != board_2->pawn[colour][i]) return false;
+      }
+
+      for (i = 0; i < FileNb; i++) {
+         if (board_1->pawn_file[colour][i] != board_2->pawn_file[colour][i]) return false;
+      }
+
+      if (board_1->colour_bb[colour] != board_2->colour_bb[colour]) return false;
+   }
+
+   if (board_1->piece_nb != board_2->piece_nb) return false;
+   for (i = 0; i < 16; i++) {
+      if (board_1->number[i] != board_2->number[i]) return false;
+   }
+
+   for (i = 0; i < 12; i++) {
+      if (board_1->piece_bb[i] != board_2->piece_bb[i]) return false;
+   }
+   if (board_1->occupied != board_2->occupied) return false;
+
+   if (board_1->turn != board_2->turn) return false;
+   if (board_1->flags != board_2->flags) return false;
+   if (board_1->ep_square != board_2->ep_square) return false;
+   if (board_1->ply_nb != board_2->ply_nb) return false;
+   if (board_1->sp != board_2->sp) return false;
+
+   if (board_1->cap_sq != board_2->cap_sq) return false;
+   if (board_1->moving_piece != board_2->moving_piece) return false;
+
+   if (board_1->opening != board_2->opening) return false;
+   if (board_1->endgame != board_2->endgame) return false;
+
+   if (board_1->key != board_2->key) return false;
+   if (board_1->pawn_key != board_2->pawn_key) return false;
+   if (board_1->material_key != board_2->material_key) return false;
+
+   if (board_1->history != board_2->history) return false;
+
+   return true;
+}
+
+#endif
+
 // end of move_do.cpp
 
@@ -9,10 +9,26 @@
 #include "board.h"
 #include "util.h"
 
+// defines
+
+// -DSNAPSHOT_UNDO: debugging aid, move_do() also saves a copy of the board in the
+// undo_t and move_undo() dies if the incremental unmake does not give it back
+
+#ifdef SNAPSHOT_UNDO
+#  undef SNAPSHOT_UNDO
+#  define SNAPSHOT_UNDO TRUE
+#else
+#  define SNAPSHOT_UNDO FALSE
+#endif
+
 // types
 
 struct undo_t {
 
+#if SNAPSHOT_UNDO
+   board_t board[1]; // the position before the move
+#endif
+
    bool capture;
 
    int capture_square;
@@ -44,6 +60,8 @@ extern void move_do_init   ();
 extern void move_do        (board_t * board, int move, undo_t * undo);
 extern void move_undo      (board_t * board, int move, const undo_t * undo);
 
+extern void move_do_key    (const board_t * board, int move, uint64 * key, uint64 * pawn_key, uint64 * material_key);
+
 extern void move_do_null   (board_t * board, undo_t * undo);
 extern void move_undo_null (board_t * board, const undo_t * undo);
 
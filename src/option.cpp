@@ -25,11 +25,14 @@ struct option_t {
 static option_t Option[] = {
 
 #ifdef IS_64
-   { "Hash", true, "64", "spin", "min 4 max 16384", NULL },
+   { "Hash", true, "64", "spin", "min 4 max 1048576", NULL },
 #else
    { "Hash", true, "64", "spin", "min 4 max 1024", NULL },
 #endif
 
+   { "Hash File", true, "<empty>", "string", "", NULL },
+   { "Eval Cache", true, "1", "spin", "min 0 max 256", NULL }, // MB per thread
+
    // JAS
    // search X seconds for the best move, equal to "go movetime"
    { "Search Time",  true, "0",   "spin",  "min 0 max 3600", NULL },
@@ -84,6 +87,9 @@ static option_t Option[] = {
    { "Toga Rook Pawn Endgame Penalty",  true, "10",    "spin",  "min 0 max 100", NULL },
    
    { "Number of Threads",   true, "1",   "spin",  "min 1 max 64", NULL },
+   { "SMP Mode",            true, "Shared Hash", "combo", "var Shared Hash var YBWC", NULL },
+   { "SMP Depth Skipping",  true, "true", "check", "", NULL },
+   { "Deterministic Search", true, "false", "check", "", NULL },
    
    { NULL, false, NULL, NULL, NULL, NULL, },
 };
@@ -13,6 +13,7 @@
 #include "piece.h"
 #include "protocol.h"
 #include "square.h"
+#include "thread.h"
 #include "util.h"
 #include "search.h"
 
@@ -25,17 +26,6 @@ static const uint32 TableSize = 16384; // was 16384 256kB tried 65536
 
 typedef pawn_info_t entry_t;
 
-struct pawn_t {
-   entry_t * table;
-   uint32 size;
-   uint32 mask;
-   uint32 used;
-   sint64 read_nb;
-   sint64 read_hit;
-   sint64 write_nb;
-   sint64 write_collision;
-};
-
 // constants and variables
 
 static /* const */ int PawnStructureWeight = 256; // 100%
@@ -82,8 +72,6 @@ int BitLast[0x100];
 int BitCount[0x100];
 int BitRev[0x100];
 
-static pawn_t Pawn[MaxThreads][1];
-
 static int BitRank1[RankNb];
 static int BitRank2[RankNb];
 static int BitRank3[RankNb];
@@ -170,7 +158,7 @@ void pawn_parameter() {
 
 void pawn_init() {
 
-   int rank, file, ThreadId;
+   int rank, file;
 
    // UCI options
 
@@ -204,50 +192,35 @@ void pawn_init() {
    FileBonus[FileF] = 1;
    //FileBonus[FileG] = 0;
    //FileBonus[FileH] = 0;
-
-   // pawn hash-table
-
-	for (ThreadId = 0; ThreadId < NumberThreads; ThreadId++){
-		Pawn[ThreadId]->size = 0;
-		Pawn[ThreadId]->mask = 0;
-		Pawn[ThreadId]->table = NULL;
-	}
 }
 
 // pawn_alloc()
 
-void pawn_alloc() {
-	
-	int ThreadId;
+void pawn_alloc(int ThreadId) {
 
    ASSERT(sizeof(entry_t)==16);
 
+   // called by the owning thread, pawn_clear() touches the table first
+
    if (UseTable) {
-		
-		for (ThreadId = 0; ThreadId < NumberThreads; ThreadId++){
-			Pawn[ThreadId]->size = TableSize;
-			Pawn[ThreadId]->mask = TableSize - 1;
-			Pawn[ThreadId]->table = (entry_t *) my_malloc(Pawn[ThreadId]->size*sizeof(entry_t));
-
-			pawn_clear(ThreadId);
-		}
+
+      Thread[ThreadId]->pawn->size = TableSize;
+      Thread[ThreadId]->pawn->mask = TableSize - 1;
+      Thread[ThreadId]->pawn->table = (entry_t *) my_malloc(Thread[ThreadId]->pawn->size*sizeof(entry_t));
+
+      pawn_clear(ThreadId);
    }
 }
 
 // pawn_free()
 
-void pawn_free() {
-	
-	int ThreadId;
+void pawn_free(int ThreadId) {
 
    ASSERT(sizeof(entry_t)==16);
 
    if (UseTable) {
-		
-                for (ThreadId = 0; ThreadId < NumberThreads; ThreadId++){
-
-		  my_free(Pawn[ThreadId]->table);
-		}
+      my_free(Thread[ThreadId]->pawn->table);
+      Thread[ThreadId]->pawn->table = NULL;
    }
 }
 
@@ -255,15 +228,22 @@ void pawn_free() {
 
 void pawn_clear(int ThreadId) {
 
-   if (Pawn[ThreadId]->table != NULL) {
-      memset(Pawn[ThreadId]->table,0,Pawn[ThreadId]->size*sizeof(entry_t));
+   if (Thread[ThreadId]->pawn->table != NULL) {
+      memset(Thread[ThreadId]->pawn->table,0,Thread[ThreadId]->pawn->size*sizeof(entry_t));
    }
 
-   Pawn[ThreadId]->used = 0;
-   Pawn[ThreadId]->read_nb = 0;
-   Pawn[ThreadId]->read_hit = 0;
-   Pawn[ThreadId]->write_nb = 0;
-   Pawn[ThreadId]->write_collision = 0;
+   Thread[ThreadId]->pawn->used = 0;
+   Thread[ThreadId]->pawn->read_nb = 0;
+   Thread[ThreadId]->pawn->read_hit = 0;
+   Thread[ThreadId]->pawn->write_nb = 0;
+   Thread[ThreadId]->pawn->write_collision = 0;
+}
+
+// pawn_prefetch()
+
+void pawn_prefetch(uint64 key, int ThreadId) {
+
+   if (UseTable) PREFETCH(&Thread[ThreadId]->pawn->table[KEY_INDEX(key)&Thread[ThreadId]->pawn->mask]);
 }
 
 // pawn_get_info()
@@ -280,16 +260,16 @@ void pawn_get_info(pawn_info_t * info, const board_t * board, int ThreadId) {
 
    if (UseTable) {
 
-      Pawn[ThreadId]->read_nb++;
+      Thread[ThreadId]->pawn->read_nb++;
 
       key = board->pawn_key;
-      entry = &Pawn[ThreadId]->table[KEY_INDEX(key)&Pawn[ThreadId]->mask];
+      entry = &Thread[ThreadId]->pawn->table[KEY_INDEX(key)&Thread[ThreadId]->pawn->mask];
 
       if (entry->lock == KEY_LOCK(key)) {
 
          // found
 
-         Pawn[ThreadId]->read_hit++;
+         Thread[ThreadId]->pawn->read_hit++;
 
          *info = *entry;
 
@@ -305,12 +285,12 @@ void pawn_get_info(pawn_info_t * info, const board_t * board, int ThreadId) {
 
    if (UseTable) {
 
-      Pawn[ThreadId]->write_nb++;
+      Thread[ThreadId]->pawn->write_nb++;
 
       if (entry->lock == 0) { // HACK: assume free entry
-         Pawn[ThreadId]->used++;
+         Thread[ThreadId]->pawn->used++;
       } else {
-         Pawn[ThreadId]->write_collision++;
+         Thread[ThreadId]->pawn->write_collision++;
       }
 
       *entry = *info;
@@ -34,6 +34,17 @@ struct pawn_info_t {
    uint16 pad;
 };
 
+struct pawn_t {
+   pawn_info_t * table;
+   uint32 size;
+   uint32 mask;
+   uint32 used;
+   sint64 read_nb;
+   sint64 read_hit;
+   sint64 write_nb;
+   sint64 write_collision;
+};
+
 // variables
 
 extern int BitEQ[16];
@@ -53,11 +64,12 @@ extern void pawn_init_bit ();
 extern void pawn_parameter();
 extern void pawn_init     ();
 
-extern void pawn_alloc    ();
-extern void pawn_free    ();
+extern void pawn_alloc    (int ThreadId);
+extern void pawn_free     (int ThreadId);
 extern void pawn_clear    (int ThreadId);
 
 extern void pawn_get_info (pawn_info_t * info, const board_t * board, int ThreadId);
+extern void pawn_prefetch (uint64 key, int ThreadId);
 
 extern int  quad          (int y_min, int y_max, int x);
 
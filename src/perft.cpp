@@ -0,0 +1,256 @@
+
+// perft.cpp
+
+// includes
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+#include <cstring>
+
+#include "board.h"
+#include "list.h"
+#include "move.h"
+#include "move_do.h"
+#include "move_gen.h"
+#include "perft.h"
+#include "posix.h"
+#include "protocol.h"
+#include "search.h"
+#include "util.h"
+
+// constants
+
+static const bool UseTable = true;
+static const int TableBits = 20; // 16 MB
+
+static const uint64 DepthMul = U64(0x9E3779B97F4A7C15); // spreads the depth over the key
+
+// types
+
+struct entry_t {
+   uint64 lock; // key ^ count, torn writes from another thread do not match
+   sint64 count;
+};
+
+struct work_t {
+   board_t board[1];
+   history_t history[1];
+   const list_t * list;
+   int depth;
+   int first;
+   int inc;
+   sint64 * count;
+};
+
+// variables
+
+static entry_t * Table;
+static uint64 TableMask;
+
+// prototypes
+
+static sint64 perft_node   (board_t * board, int depth);
+static void   perft_work   (work_t * work);
+
+#ifdef _WIN32
+static unsigned __stdcall perft_thread (void * param);
+#else
+static void * perft_thread (void * param);
+#endif
+
+// functions
+
+// perft()
+
+sint64 perft(const board_t * board, int depth, bool divide) {
+
+   list_t list[1];
+   board_t root[1];
+   work_t work[MaxThreads];
+   sint64 count[256];
+   sint64 node_nb;
+   double start_time, time;
+   int thread_nb;
+   char move_string[256];
+   int i;
+#ifdef _WIN32
+   HANDLE handle[MaxThreads];
+#else
+   pthread_t handle[MaxThreads];
+#endif
+
+   ASSERT(board!=NULL);
+   ASSERT(depth>=0);
+
+   start_time = now_real();
+
+   board_copy(root,board);
+   gen_legal_moves(list,root);
+
+   if (UseTable) {
+      TableMask = (U64(1) << TableBits) - 1;
+      Table = (entry_t *) my_malloc((TableMask+1)*sizeof(entry_t));
+      memset(Table,0,(TableMask+1)*sizeof(entry_t));
+   }
+
+   // split the root moves between the threads
+
+   for (i = 0; i < LIST_SIZE(list); i++) count[i] = 0;
+
+   thread_nb = NumberThreads;
+   if (thread_nb > LIST_SIZE(list)) thread_nb = LIST_SIZE(list);
+   if (thread_nb < 1 || depth <= 1) thread_nb = 1;
+
+   for (i = 0; i < thread_nb; i++) {
+      board_fork(work[i].board,root,work[i].history);
+      work[i].list = list;
+      work[i].depth = depth;
+      work[i].first = i;
+      work[i].inc = thread_nb;
+      work[i].count = count;
+   }
+
+   for (i = 1; i < thread_nb; i++) {
+#ifdef _WIN32
+      handle[i] = (HANDLE) _beginthreadex(NULL,0,&perft_thread,&work[i],0,NULL);
+#else
+      pthread_create(&handle[i],NULL,perft_thread,&work[i]);
+#endif
+   }
+
+   if (depth == 0) {
+      node_nb = 1;
+   } else {
+      perft_work(&work[0]);
+      node_nb = 0;
+   }
+
+   for (i = 1; i < thread_nb; i++) {
+#ifdef _WIN32
+      WaitForSingleObject(handle[i],INFINITE);
+      CloseHandle(handle[i]);
+#else
+      pthread_join(handle[i],NULL);
+#endif
+   }
+
+   if (UseTable) {
+      my_free(Table);
+      Table = NULL;
+   }
+
+   time = now_real() - start_time;
+
+   // report
+
+   if (depth > 0) {
+      for (i = 0; i < LIST_SIZE(list); i++) {
+         node_nb += count[i];
+         if (divide) {
+            move_to_string(LIST_MOVE(list,i),move_string,256);
+            send("%s: " S64_FORMAT,move_string,count[i]);
+         }
+      }
+   }
+
+   send("info string perft %d nodes " S64_FORMAT " time %.0f nps %.0f",depth,node_nb,time*1000.0,(time>0.0)?double(node_nb)/time:0.0);
+
+   return node_nb;
+}
+
+// perft_work()
+
+static void perft_work(work_t * work) {
+
+   int i, move;
+   undo_t undo[1];
+
+   ASSERT(work!=NULL);
+   ASSERT(work->depth>=1);
+
+   for (i = work->first; i < LIST_SIZE(work->list); i += work->inc) {
+
+      move = LIST_MOVE(work->list,i);
+
+      move_do(work->board,move,undo);
+      work->count[i] = perft_node(work->board,work->depth-1);
+      move_undo(work->board,move,undo);
+   }
+}
+
+// perft_node()
+
+static sint64 perft_node(board_t * board, int depth) {
+
+   list_t list[1];
+   undo_t undo[1];
+   entry_t * entry;
+   entry_t copy[1];
+   uint64 key;
+   sint64 node_nb;
+   int i, move;
+
+   ASSERT(board!=NULL);
+   ASSERT(depth>=0);
+
+   if (depth == 0) return 1;
+
+   gen_legal_moves(list,board);
+
+   if (depth == 1) return LIST_SIZE(list); // bulk counting
+
+   // subtree already counted?
+
+   key = board->key ^ (uint64(depth) * DepthMul);
+   entry = NULL;
+
+   if (UseTable) {
+      entry = &Table[key&TableMask];
+      *copy = *entry; // snapshot, the count must be the one that was checked
+      if ((copy->lock ^ uint64(copy->count)) == key) return copy->count;
+   }
+
+   node_nb = 0;
+
+   for (i = 0; i < LIST_SIZE(list); i++) {
+
+      move = LIST_MOVE(list,i);
+
+      move_do(board,move,undo);
+      node_nb += perft_node(board,depth-1);
+      move_undo(board,move,undo);
+   }
+
+   if (UseTable) {
+      entry->count = node_nb;
+      entry->lock = key ^ uint64(node_nb);
+   }
+
+   return node_nb;
+}
+
+// perft_thread()
+
+#ifdef _WIN32
+static unsigned __stdcall perft_thread(void * param) {
+
+   perft_work((work_t *) param);
+
+   return 0;
+}
+#else
+static void * perft_thread(void * param) {
+
+   perft_work((work_t *) param);
+
+   return NULL;
+}
+#endif
+
+// end of perft.cpp
+
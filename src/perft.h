@@ -0,0 +1,19 @@
+
+// perft.h
+
+#ifndef PERFT_H
+#define PERFT_H
+
+// includes
+
+#include "board.h"
+#include "util.h"
+
+// functions
+
+extern sint64 perft (const board_t * board, int depth, bool divide);
+
+#endif // !defined PERFT_H
+
+// end of perft.h
+
@@ -12,8 +12,9 @@
 #if defined(_WIN32) || defined(_WIN64)
 #  include <windows.h>
 #else // assume POSIX
+#  include <sys/mman.h>
 #  include <sys/resource.h>
-// #  include <sys/select.h>
+#  include <sys/syscall.h>
 #  include <sys/time.h>
 #  include <sys/types.h>
 #  include <unistd.h>
@@ -24,7 +25,10 @@
 
 // constants
 
-static const bool UseDebug = false;
+static const bool UseLargePages = true;
+static const bool UseInterleave = true; // spread pages over all NUMA nodes
+
+static const uint64 LargePageSize = 2 * 1024 * 1024; // x86 huge page
 
 // prototypes
 
@@ -34,143 +38,176 @@ static double duration (const struct timeval * tv);
 
 // functions
 
-// input_available()
+// now_real()
 
-bool input_available() {
+double now_real() {
 
 #if defined(_WIN32) || defined(_WIN64)
 
-   static bool init = false, is_pipe;
-   static HANDLE stdin_h;
-   DWORD val, error;
+   return double(GetTickCount()) / 1000.0;
 
-   // val = 0; // needed to make the compiler happy?
+#else // assume POSIX
 
-   // have a look at the "local" buffer first, *this time before init (no idea if it helps)*
+   struct timeval tv[1];
+   struct timezone tz[1];
 
-   // if (UseDebug && !init) printf("info string init=%d stdin->_cnt=%d\n",int(init),stdin->_cnt);
+   tz->tz_minuteswest = 0;
+   tz->tz_dsttime = 0; // DST_NONE not declared in linux
 
-   // if (stdin->_cnt > 0) return true; // HACK: assumes FILE internals
+   if (gettimeofday(tv,tz) == -1) { // tz needed at all?
+      my_fatal("now_real(): gettimeofday(): %s\n",strerror(errno));
+   }
 
-   // input init (only done once)
+   return duration(tv);
 
-   if (!init) {
+#endif
+}
 
-      init = true;
+// now_cpu()
 
-      stdin_h = GetStdHandle(STD_INPUT_HANDLE);
+double now_cpu() {
 
-      if (UseDebug && (stdin_h == NULL || stdin_h == INVALID_HANDLE_VALUE)) {
-         error = GetLastError();
-         printf("info string GetStdHandle() failed, error=%d\n",error);
-      }
+#if defined(_WIN32) || defined(_WIN64)
 
-      is_pipe = !GetConsoleMode(stdin_h,&val); // HACK: assumes pipe on failure
+   return double(clock()) / double(CLOCKS_PER_SEC); // OK if CLOCKS_PER_SEC is small enough
 
-      if (UseDebug) printf("info string init=%d is_pipe=%d\n",int(init),int(is_pipe));
+#else // assume POSIX
 
-      if (UseDebug && is_pipe) { // GetConsoleMode() failed, everybody assumes pipe then
-         error = GetLastError();
-         printf("info string GetConsoleMode() failed, error=%d\n",error);
-      }
+   struct rusage ru[1];
 
-      if (!is_pipe) {
-         SetConsoleMode(stdin_h,val&~(ENABLE_MOUSE_INPUT|ENABLE_WINDOW_INPUT));
-         FlushConsoleInputBuffer(stdin_h); // no idea if we can lose data doing this
-      }
+   if (getrusage(RUSAGE_SELF,ru) == -1) {
+      my_fatal("now_cpu(): getrusage(): %s\n",strerror(errno));
    }
 
-   // different polling depending on input type
-   // does this code work at all for pipes?
+   return duration(&ru->ru_utime);
+
+#endif
+}
 
-   if (is_pipe) {
+// page_alloc()
 
-      if (!PeekNamedPipe(stdin_h,NULL,0,NULL,&val,NULL)) {
+void * page_alloc(uint64 size, bool * large) {
 
-         if (UseDebug) { // PeekNamedPipe() failed, everybody assumes EOF then
-            error = GetLastError();
-            printf("info string PeekNamedPipe() failed, error=%d\n",error);
-         }
+   void * address;
 
-         return true; // HACK: assumes EOF on failure
-      }
+   ASSERT(size>0);
+   ASSERT(large!=NULL);
 
-      if (UseDebug && val < 0) printf("info string PeekNamedPipe(): val=%d\n",val);
+   *large = false;
 
-      return val > 0; // != 0???
+#if defined(_WIN32) || defined(_WIN64)
 
-   } else {
+   SIZE_T page_size;
 
-      GetNumberOfConsoleInputEvents(stdin_h,&val);
-      return val > 1; // no idea why 1
+   // large pages need the "Lock pages in memory" privilege, fall back silently
+
+   address = NULL;
+   page_size = GetLargePageMinimum();
+
+   if (UseLargePages && page_size != 0 && size % page_size == 0) {
+      address = VirtualAlloc(NULL,size,MEM_RESERVE|MEM_COMMIT|MEM_LARGE_PAGES,PAGE_READWRITE);
+      if (address != NULL) *large = true;
    }
 
-   return false;
+   if (address == NULL) address = VirtualAlloc(NULL,size,MEM_RESERVE|MEM_COMMIT,PAGE_READWRITE);
+   if (address == NULL) my_fatal("page_alloc(): VirtualAlloc(): error %d\n",GetLastError());
 
 #else // assume POSIX
 
-   int val;
-   fd_set set[1];
-   struct timeval time_val[1];
+   address = MAP_FAILED;
+
+#  ifdef MAP_HUGETLB
+   if (UseLargePages && size % LargePageSize == 0) { // reserved huge pages, rarely configured
+      address = mmap(NULL,size,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB,-1,0);
+      if (address != MAP_FAILED) *large = true;
+   }
+#  endif
 
-   FD_ZERO(set);
-   FD_SET(STDIN_FILENO,set);
+   if (address == MAP_FAILED) {
 
-   time_val->tv_sec = 0;
-   time_val->tv_usec = 0;
+      address = mmap(NULL,size,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+      if (address == MAP_FAILED) my_fatal("page_alloc(): mmap(): %s\n",strerror(errno));
 
-   val = select(STDIN_FILENO+1,set,NULL,NULL,time_val);
-   if (val == -1 && errno != EINTR) {
-      my_fatal("input_available(): select(): %s\n",strerror(errno));
+#  ifdef MADV_HUGEPAGE
+      if (UseLargePages && size >= LargePageSize) { // transparent huge pages, only a hint, see page_huge()
+         madvise(address,size,MADV_HUGEPAGE);
+      }
+#  endif
    }
 
-   return val > 0;
+#  if defined(__linux__) && defined(SYS_mbind)
+   if (UseInterleave) {
+
+      unsigned long node_mask[16]; // 1024 nodes
+      const int MpolInterleave = 3; // <numaif.h> MPOL_INTERLEAVE, no libnuma needed
+
+      memset(node_mask,0xFF,sizeof(node_mask)); // the kernel restricts to nodes with memory
+
+      syscall(SYS_mbind,address,size,MpolInterleave,node_mask,sizeof(node_mask)*8,0); // fails harmlessly without NUMA
+   }
+#  endif
 
 #endif
+
+   return address;
 }
 
-// now_real()
+// page_free()
 
-double now_real() {
+void page_free(void * address, uint64 size) {
+
+   ASSERT(address!=NULL);
+   ASSERT(size>0);
 
 #if defined(_WIN32) || defined(_WIN64)
 
-   return double(GetTickCount()) / 1000.0;
+   VirtualFree(address,0,MEM_RELEASE);
 
 #else // assume POSIX
 
-   struct timeval tv[1];
-   struct timezone tz[1];
-
-   tz->tz_minuteswest = 0;
-   tz->tz_dsttime = 0; // DST_NONE not declared in linux
-
-   if (gettimeofday(tv,tz) == -1) { // tz needed at all?
-      my_fatal("now_real(): gettimeofday(): %s\n",strerror(errno));
-   }
-
-   return duration(tv);
+   if (munmap(address,size) == -1) my_fatal("page_free(): munmap(): %s\n",strerror(errno));
 
 #endif
 }
 
-// now_cpu()
+// page_huge()
 
-double now_cpu() {
+uint64 page_huge(const void * address, uint64 size) {
 
-#if defined(_WIN32) || defined(_WIN64)
+   ASSERT(address!=NULL);
+   ASSERT(size>0);
 
-   return double(clock()) / double(CLOCKS_PER_SEC); // OK if CLOCKS_PER_SEC is small enough
+#if defined(__linux__)
 
-#else // assume POSIX
+   FILE * file;
+   char string[256];
+   unsigned long long start, end, kb;
+   bool inside;
+   uint64 huge;
 
-   struct rusage ru[1];
+   // sum the transparent huge pages the kernel actually backs the range with
 
-   if (getrusage(RUSAGE_SELF,ru) == -1) {
-      my_fatal("now_cpu(): getrusage(): %s\n",strerror(errno));
+   file = fopen("/proc/self/smaps","r");
+   if (file == NULL) return 0;
+
+   inside = false;
+   huge = 0;
+
+   while (fgets(string,256,file) != NULL) {
+      if (strncmp(string,"AnonHugePages:",14) == 0) {
+         if (inside && sscanf(&string[14],"%llu",&kb) == 1) huge += uint64(kb) * 1024;
+      } else if (sscanf(string,"%llx-%llx ",&start,&end) == 2) { // a new mapping
+         inside = start < uint64((const char *) address + size) && end > uint64(address);
+      }
    }
 
-   return duration(&ru->ru_utime);
+   fclose(file);
+
+   return huge;
+
+#else
+
+   return 0; // no transparent huge pages, large pages are reported by page_alloc()
 
 #endif
 }
@@ -10,11 +10,13 @@
 
 // functions
 
-extern bool   input_available ();
-
 extern double now_real        ();
 extern double now_cpu         ();
 
+extern void * page_alloc      (uint64 size, bool * large);
+extern void   page_free       (void * address, uint64 size);
+extern uint64 page_huge       (const void * address, uint64 size);
+
 #endif // !defined POSIX_H
 
 // end of posix.h
@@ -11,20 +11,24 @@
 #include <windows.h>
 #endif
 
+#include "bitboard.h"
 #include "board.h"
 #include "book.h"
 #include "eval.h"
 #include "fen.h"
+#include "input.h"
 #include "material.h"
 #include "move.h"
 #include "move_do.h"
 #include "move_legal.h"
 #include "option.h"
 #include "pawn.h"
+#include "perft.h"
 #include "posix.h"
 #include "protocol.h"
 #include "pst.h"
 #include "search.h"
+#include "search_full.h"
 #include "trans.h"
 #include "util.h"
 //#include "sort.h"
@@ -37,6 +41,65 @@
 static const double NormalRatio = 1.0;
 static const double PonderRatio = 1.25;
 
+static const int BenchHash = 16;
+static const int BenchThreads = 1;
+static const int BenchDepth = 11;
+static const int BenchNodeLimit = 123457; // odd on purpose, "go nodes" must stop right there
+
+static const int AttackBenchRepeat = 2000;
+static const int HashStressProbe = 1000000; // per thread
+
+static const int OvershootMax = 1024; // searches kept for the percentile
+
+// positions searched by "bench", from the opening to the late endgame
+
+static const char * const BenchFen[] = {
+   "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+   "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+   "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
+   "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+   "rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w - - 7 14",
+   "r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - - 2 14",
+   "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
+   "r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
+   "r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - - 1 16",
+   "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 1 17",
+   "2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ - 0 11",
+   "r1bq1r1k/b1p1npp1/p2p3p/1p6/3PP3/1B2NN2/PP3PPP/R2Q1RK1 w - - 1 16",
+   "3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b - - 6 22",
+   "r1q2rk1/2p1bppp/2Pp4/p6b/Q1PNp3/4B3/PP1R1PPP/2K4R w - - 2 18",
+   "4k2r/1pb2ppp/1p2p3/1R1p4/3P4/2r1PN2/P4PPP/1R4K1 b - - 3 22",
+   "3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b - - 4 26",
+   "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/3N4 b - - 0 1",
+   "3b4/5kp1/1p1p1p1p/pP1PpP1P/P1P1P3/3KN3/8/8 w - - 0 1",
+   "2K5/p7/7P/5pR1/8/5k2/r7/8 w - - 0 1",
+   "8/6pk/1p6/8/PP3p1p/5P2/4KP1q/3Q4 w - - 0 1",
+   "7k/3p2pp/4q3/8/4Q3/5Kp1/P6b/8 w - - 0 1",
+   "8/2p5/8/2kPKp1p/2p4P/2P5/3P4/8 w - - 0 1",
+   "8/1p3pp1/7p/5P1P/2k3P1/8/2K2P2/8 w - - 0 1",
+   "8/pp2r1k1/2p1p3/3pP2p/1P1P1P1P/P5KR/8/8 w - - 0 1",
+   "8/3p4/p1bk3p/Pp6/1Kp1PpPp/2P2P1P/2P5/5B2 b - - 0 1",
+   "5k2/7R/4P2p/5K2/p1r2P1p/8/8/8 b - - 0 1",
+   "6k1/6p1/P6p/r1N5/5p2/7P/1b3PP1/4R1K1 w - - 0 1",
+   "1r3k2/4q3/2Pp3b/3Bp3/2Q2p2/1p1P2P1/1P2KP2/3N4 w - - 0 1",
+   "6k1/4pp1p/3p2p1/P1pPb3/R7/1r2P1PP/3B1P2/6K1 w - - 0 1",
+   "8/3p3B/5p2/5P2/p7/PP5b/k7/6K1 w - - 0 1",
+   "5rk1/q6p/2p3bR/1pPp1rP1/1P1Pp3/P3B1Q1/1K3P2/R7 w - - 93 90",
+   "4rrk1/1p1nq3/p7/2p1P1pp/3P2bp/3Q1Bn1/PPPB4/1K2R1NR w - - 40 21",
+   "r3k2r/3nnpbp/q2pp1p1/p7/Pp1PPPP1/4BNN1/1P5P/R2Q1RK1 w kq - 0 16",
+   "3Qb1k1/1r2ppb1/pN1n2q1/Pp1Pp1Pr/4P2p/4BP2/4B1R1/1R5K b - - 11 40",
+   "4k3/3q1r2/1N2r1b1/3ppN2/2nPP3/1B1R2n1/2R1Q3/3K4 w - - 5 1",
+   "8/8/8/8/5kp1/P7/8/1K1N4 w - - 0 1",
+   "8/8/8/5N2/8/p7/8/2NK3k w - - 0 1",
+   "8/3k4/8/8/8/4B3/4KB2/2B5 w - - 0 1",
+   "8/8/1P6/5pr1/8/4R3/7k/2K5 w - - 0 1",
+   "8/2p4P/8/kr6/6R1/8/8/1K6 w - - 0 1",
+   "8/8/3P3k/8/1p6/8/1P6/1K3n2 b - - 0 1",
+   "8/R7/2q5/8/6k1/8/1P5p/K6R w - - 0 124",
+};
+
+static const int BenchFenNb = sizeof(BenchFen) / sizeof(BenchFen[0]);
+
 // variables
 
 #ifdef _WIN32
@@ -47,11 +110,17 @@ pthread_mutex_t CriticalSection=PTHREAD_MUTEX_INITIALIZER;
 
 
 static bool Init;
+static bool CommandLine; // "toga bench": no UCI input to poll
+static bool Benching; // bench in progress, input waits in the queue until it is done
+static bool Debug; // UCI "debug on"
 
 static bool Searching; // search in progress?
 static bool Infinite; // infinite or ponder mode?
 static bool Delay; // postpone "bestmove" in infinite/ponder mode?
 
+static double Overshoot[OvershootMax]; // "bestmove" after the hard deadline, in seconds
+static int OvershootNb;
+
 //static char * dirptr = "C:/egbb";
 
 // prototypes
@@ -59,12 +128,20 @@ static bool Delay; // postpone "bestmove" in infinite/ponder mode?
 static void init              ();
 static void loop_step         ();
 
+static void parse_attack_bench (char string[]);
+static void parse_bench       (char string[]);
 static void parse_go          (char string[]);
 static void parse_position    (char string[]);
 static void parse_setoption   (char string[]);
 
+static int  search_threads    ();
 static void send_best_move    ();
 
+static void overshoot_add     (double overshoot);
+static int  overshoot_compare (const void * a, const void * b);
+
+static const char * hash_file_name (const char string[]);
+
 static bool string_equal      (const char s1[], const char s2[]);
 static bool string_start_with (const char s1[], const char s2[]);
 
@@ -89,6 +166,7 @@ void loop() {
    // init (to help debugging)
 
    Init = false;
+   Benching = false;
 
    Searching = false;
    Infinite = false;
@@ -98,6 +176,10 @@ void loop() {
 
    board_from_fen(SearchInput->board,StartFen);
 
+   // stdin is read by its own thread from now on
+
+   input_init();
+
    // loop
 
    while (true) loop_step();
@@ -113,8 +195,7 @@ static void init() {
 
       Init = true;
 
-      NumberThreads=option_get_int("Number of Threads");
-      if(NumberThreads>MaxThreads) NumberThreads=MaxThreads;
+      NumberThreads=search_threads();
 		
       book_parameter();
       
@@ -123,18 +204,15 @@ static void init() {
       trans_alloc(Trans);
 
       pawn_init();
-      pawn_alloc();
-
       material_init();
-      material_alloc();
 
       pst_init();
       eval_init();
+      search_full_split_init();
 #ifdef _WIN32
 	  InitializeCriticalSection(&CriticalSection);
 #endif
-	  SearchInput->exit_engine = false;
-	  start_suspend_threads();
+	  pool_create();
    }
 
 }
@@ -143,7 +221,7 @@ static void init() {
 
 void event() {
 
-   while (!SearchInfo[0]->stop && input_available()) loop_step();
+   while (!CommandLine && !Benching && !SearchInfo[0]->stop && input_available()) loop_step();
 }
 
 // loop_step()
@@ -167,9 +245,42 @@ static void loop_step() {
 
    if (false) {
 
+   } else if (string_equal(string,"attackbench") || string_start_with(string,"attackbench ")) {
+
+      // non-standard: attackbench [repeat], slider attack lookups per second
+
+      if (!Searching && !Delay) {
+         init();
+         parse_attack_bench(string);
+      } else {
+         ASSERT(false);
+      }
+
+   } else if (string_equal(string,"bench") || string_start_with(string,"bench ")) {
+
+      // non-standard: bench [hash] [threads] [depth]
+
+      if (!Searching && !Delay) {
+         init();
+         parse_bench(string);
+      } else {
+         ASSERT(false);
+      }
+
+   } else if (string_start_with(string,"divide ")) {
+
+      // non-standard: divide <depth>, perft with a count per root move
+
+      if (!Searching && !Delay) {
+         init();
+         perft(SearchInput->board,atoi(string+7),true);
+      } else {
+         ASSERT(false);
+      }
+
    } else if (string_start_with(string,"debug ")) {
 
-      // dummy
+      Debug = string_equal(string,"debug on");
 
    } else if (string_start_with(string,"go ")) {
 
@@ -207,6 +318,17 @@ static void loop_step() {
          ASSERT(false);
       }
 
+   } else if (string_start_with(string,"perft ")) {
+
+      // non-standard: perft <depth>, legal move-path count of the current position
+
+      if (!Searching && !Delay) {
+         init();
+         perft(SearchInput->board,atoi(string+6),false);
+      } else {
+         ASSERT(false);
+      }
+
    } else if (string_start_with(string,"position ")) {
 
       if (!Searching && !Delay) {
@@ -221,8 +343,7 @@ static void loop_step() {
       ASSERT(!Searching);
       ASSERT(!Delay);
 
-	  SearchInput->exit_engine = true;
-	  resume_threads();
+      pool_destroy();
       exit(EXIT_SUCCESS);
 
    } else if (string_start_with(string,"setoption ")) {
@@ -244,6 +365,7 @@ static void loop_step() {
 
 			for (ThreadId = 0; ThreadId < NumberThreads; ThreadId++){
 				SearchInfo[ThreadId]->stop = true;
+				SearchInfo[ThreadId]->poll = true;
 			}
 
          Infinite = false;
@@ -266,6 +388,49 @@ static void loop_step() {
 
       send("uciok");
 
+   } else if (string_equal(string,"hashstress") || string_start_with(string,"hashstress ")) {
+
+      // non-standard: hashstress [probes], all the threads on one small table, counts torn entries
+
+      if (!Searching && !Delay) {
+         init();
+         trans_stress((strlen(string) > 11) ? atoi(string+11) : HashStressProbe);
+      } else {
+         ASSERT(false);
+      }
+
+   } else if (string_equal(string,"hashstats")) {
+
+      // non-standard: hash-table diagnostics of the last search
+
+      if (!Searching && !Delay && Init) {
+         trans_wait(Trans);
+         trans_report(Trans);
+      } else {
+         ASSERT(false);
+      }
+
+   } else if (string_equal(string,"savehash") || string_start_with(string,"savehash ")) {
+
+      // non-standard: savehash [file]
+
+      if (!Searching && !Delay && Init) {
+         trans_save(Trans,hash_file_name(string));
+      } else {
+         ASSERT(false);
+      }
+
+   } else if (string_equal(string,"loadhash") || string_start_with(string,"loadhash ")) {
+
+      // non-standard: loadhash [file]
+
+      if (!Searching && !Delay) {
+         init();
+         if (!trans_load(Trans,hash_file_name(string))) send("info string no hash loaded");
+      } else {
+         ASSERT(false);
+      }
+
    } else if (string_equal(string,"ucinewgame")) {
 
       if (!Searching && !Delay && Init) {
@@ -276,6 +441,227 @@ static void loop_step() {
    }
 }
 
+// bench()
+
+void bench(int argc, char * argv[]) {
+
+   char string[256];
+   int i;
+
+   ASSERT(argc>=1);
+   ASSERT(argv!=NULL);
+
+   // command-line mode: "toga bench [hash] [threads] [depth]"
+
+   strcpy(string,"bench");
+
+   for (i = 1; i < argc && i <= 3; i++) {
+      if (strlen(string) + 1 + strlen(argv[i]) >= sizeof(string)) break;
+      strcat(string," ");
+      strcat(string,argv[i]);
+   }
+
+   CommandLine = true;
+
+   init();
+   search_clear(); // attaches the key history, as in loop()
+   parse_bench(string);
+
+   pool_destroy();
+}
+
+// parse_attack_bench()
+
+static void parse_attack_bench(char string[]) {
+
+   static const char * const MethodName[3] = { "ray", "magic", "pext" };
+
+   const char * ptr;
+   int repeat;
+   int pos, method;
+   uint64 occupied[BenchFenNb];
+   uint64 check, first_check;
+   sint64 query_nb;
+   double time;
+
+   // arguments
+
+   repeat = AttackBenchRepeat;
+
+   ptr = strtok(string," "); // skip "attackbench"
+
+   if ((ptr = strtok(NULL," ")) != NULL) repeat = atoi(ptr);
+   if (repeat < 1) repeat = 1;
+
+   // occupancy of the bench positions
+
+   for (pos = 0; pos < BenchFenNb; pos++) {
+      board_from_fen(SearchInput->board,BenchFen[pos]);
+      occupied[pos] = SearchInput->board->occupied;
+   }
+
+   // a bishop and a rook lookup from every square
+
+   query_nb = sint64(repeat) * BenchFenNb * 64 * 2;
+   first_check = 0;
+
+   for (method = SliderRay; method <= SliderPext; method++) {
+
+      if (method == SliderPext && !bitboard_pext()) {
+         send("info string attackbench pext not supported by this CPU or build");
+         continue;
+      }
+
+      check = slider_bench(method,occupied,BenchFenNb,repeat,&time);
+
+      if (method == SliderRay) first_check = check;
+
+      send("info string attackbench %s queries " S64_FORMAT " time %.0f mqps %.1f%s",MethodName[method],query_nb,time*1000.0,(time>0.0)?double(query_nb)/time/1000000.0:0.0,(check!=first_check)?" MISMATCH":"");
+   }
+
+   send("info string attackbench in use: %s",UsePext?"pext":"magic");
+}
+
+// parse_bench()
+
+static void parse_bench(char string[]) {
+
+   const char * ptr;
+   int hash, threads, depth;
+   int pos, max_depth;
+   char option[256], old_hash[256], old_threads[256], old_book[256];
+   sint64 node_nb, total_nb;
+   sint64 eval_nb, eval_hit, old_eval_nb, old_eval_hit;
+   uint32 signature;
+   double start_time, time;
+
+   // arguments
+
+   hash = BenchHash;
+   threads = BenchThreads;
+   depth = BenchDepth;
+
+   ptr = strtok(string," "); // skip "bench"
+
+   if ((ptr = strtok(NULL," ")) != NULL) hash = atoi(ptr);
+   if ((ptr = strtok(NULL," ")) != NULL) threads = atoi(ptr);
+   if ((ptr = strtok(NULL," ")) != NULL) depth = atoi(ptr);
+
+   if (hash < 4) hash = 4;
+   if (threads < 1) threads = 1;
+   if (threads > MaxThreads) threads = MaxThreads;
+   if (depth < 1) depth = 1;
+   if (depth > DepthMax - 1) depth = DepthMax - 1;
+
+   // options, restored at the end
+
+   strcpy(old_hash,option_get_string("Hash"));
+   strcpy(old_threads,option_get_string("Number of Threads"));
+   strcpy(old_book,option_get_string("OwnBook"));
+
+   sprintf(option,"setoption name Hash value %d",hash);
+   parse_setoption(option);
+   sprintf(option,"setoption name Number of Threads value %d",threads);
+   parse_setoption(option);
+   option_set("OwnBook","false");
+
+   trans_wait(Trans);
+
+   Benching = true; // commands sent meanwhile are handled by loop() afterwards
+
+   // search each position from an empty hash table
+
+   total_nb = 0;
+   signature = 0;
+   time = 0.0;
+
+   eval_hits(&old_eval_nb,&old_eval_hit);
+
+   for (pos = 0; pos < BenchFenNb; pos++) {
+
+      send("info string bench position %d/%d %s",pos+1,BenchFenNb,BenchFen[pos]);
+
+      board_from_fen(SearchInput->board,BenchFen[pos]);
+      trans_clear(Trans);
+
+      search_clear();
+
+      SearchInput->depth_is_limited = true;
+      SearchInput->depth_limit = depth;
+
+      Searching = true;
+      Infinite = false;
+      Delay = false;
+
+      start_time = now_real();
+
+      search();
+
+      time += now_real() - start_time;
+
+      Searching = false;
+
+      search_total(&node_nb,&max_depth);
+
+      total_nb += node_nb;
+      signature = signature * 31 + uint32(node_nb) + uint32(SearchBest[0][0].move); // every count and best move counts
+   }
+
+   // report
+
+   send("info string bench hash %d threads %d depth %d positions %d",hash,NumberThreads,depth,BenchFenNb);
+   send("info string bench nodes " S64_FORMAT " time %.0f nps %.0f",total_nb,time*1000.0,(time>0.0)?double(total_nb)/time:0.0);
+   send("info string bench signature %08X nodes " S64_FORMAT,signature,total_nb);
+
+   eval_hits(&eval_nb,&eval_hit);
+   eval_nb -= old_eval_nb;
+   eval_hit -= old_eval_hit;
+
+   send("info string bench eval cache %d MB probes " S64_FORMAT " hits " S64_FORMAT " (%.1f%%)",option_get_int("Eval Cache"),eval_nb,eval_hit,(eval_nb>0)?double(eval_hit)*100.0/double(eval_nb):0.0);
+
+   // node limit, exact with one thread only (see search_check())
+
+   if (NumberThreads == 1) {
+
+      board_from_fen(SearchInput->board,BenchFen[0]);
+      trans_clear(Trans);
+
+      search_clear();
+
+      SearchInput->node_is_limited = true;
+      SearchInput->node_limit = BenchNodeLimit;
+
+      Searching = true;
+      Infinite = false;
+      Delay = false;
+
+      search();
+
+      Searching = false;
+
+      search_total(&node_nb,&max_depth);
+
+      send("info string bench node limit %d nodes " S64_FORMAT "%s",BenchNodeLimit,node_nb,(node_nb!=BenchNodeLimit)?" MISMATCH":"");
+   }
+
+   Benching = false;
+
+   // restore the GUI's settings, the command line exits right away
+
+   if (CommandLine) return;
+
+   sprintf(option,"setoption name Hash value %s",old_hash);
+   parse_setoption(option);
+   sprintf(option,"setoption name Number of Threads value %s",old_threads);
+   parse_setoption(option);
+   option_set("OwnBook",old_book);
+
+   trans_wait(Trans);
+   trans_clear(Trans);
+
+   board_from_fen(SearchInput->board,StartFen);
+}
+
 // parse_go()
 
 static void parse_go(char string[]) {
@@ -471,6 +857,18 @@ static void parse_go(char string[]) {
       SearchInput->time_limit_2 = alloc;
    }
 
+   // node limit, summed over the threads
+
+   if (nodes >= 0) {
+
+      SearchInput->node_is_limited = true;
+      SearchInput->node_limit = nodes;
+
+      // a fixed-node search must not depend on the machine load
+
+      if (option_get_bool("Deterministic Search")) SearchInput->time_is_limited = false;
+   }
+
    if (infinite || ponder) SearchInput->infinite = true;
 
    // search
@@ -588,27 +986,52 @@ static void parse_setoption(char string[]) {
       ASSERT(!Searching);
 
       if (option_get_int("Hash") >= 4) {
-         trans_free(Trans);
-         trans_alloc(Trans);
+         trans_resize(Trans); // keeps the entries, see trans_wait()
       }
    }
    
-   if (Init && my_string_equal(name,"Number of Threads")) { // Init => already started
+   if (Init && (my_string_equal(name,"Number of Threads") || my_string_equal(name,"Deterministic Search"))) { // Init => already started
      
      ASSERT(!Searching);
      
-     if (option_get_int("Number of Threads")!= NumberThreads) {
-       exit_threads();
-       pawn_free();
-       material_free();
-       NumberThreads=option_get_int("Number of Threads");
-       if(NumberThreads>MaxThreads) NumberThreads=MaxThreads;
-       pawn_alloc();
-       material_alloc();
+     if (search_threads()!= NumberThreads) {
+       pool_destroy();
+       NumberThreads=search_threads();
+       pool_create();
        search_clear();
-       start_suspend_threads();
      }
    }
+
+   if (my_string_equal(name,"Eval Cache")) { // per thread, each one reallocates its own
+
+      ASSERT(!Searching);
+
+      if (Init) pool_destroy();
+
+      eval_free(0);
+      eval_alloc(0);
+
+      if (Init) {
+         pool_create();
+         search_clear();
+      }
+   }
+}
+
+// search_threads()
+
+static int search_threads() {
+
+   int thread_nb;
+
+   // a deterministic search runs on the main thread only
+
+   if (option_get_bool("Deterministic Search")) return 1;
+
+   thread_nb = option_get_int("Number of Threads");
+   if (thread_nb > MaxThreads) thread_nb = MaxThreads;
+
+   return thread_nb;
 }
 
 // send_best_move()
@@ -619,29 +1042,25 @@ static void send_best_move() {
    sint64 node_nb;
    char move_string[256];
    char ponder_string[256];
-   int move;
+   int move, max_depth;
    int ThreadId, bestThreadId;
    mv_t * pv;
+   double overshoot;
 
    // info
 
    // HACK: should be in search.cpp
 
    time = SearchCurrent[0]->time;
-   speed = 0;
-   for (ThreadId = 0; ThreadId < NumberThreads; ThreadId++){
-		speed += SearchCurrent[ThreadId]->speed;
-   }
    cpu = SearchCurrent[0]->cpu;
 
-   node_nb = 0;
-   for (ThreadId = 0; ThreadId < NumberThreads; ThreadId++){
-		node_nb += SearchCurrent[ThreadId]->node_nb;
-   }
+   search_total(&node_nb,&max_depth);
+   speed = (time > 0.0) ? double(node_nb) / time : 0.0;
 
-   send("info time %.0f nodes " S64_FORMAT " nps %.0f cpuload %.0f",time*1000.0,node_nb,speed,cpu*1000.0);
+   send("info time %.0f nodes " S64_FORMAT " nps %.0f cpuload %.0f seldepth %d",time*1000.0,node_nb,speed,cpu*1000.0,max_depth);
 
    trans_stats(Trans);
+   if (Debug && NumberThreads > 1) send("info string stop latency %.3f ms",pool_stop_time()*1000.0);
    // pawn_stats();
    // material_stats();
 
@@ -668,6 +1087,14 @@ static void send_best_move() {
 	   fclose(fp); 
    }*/
 
+   // how late "bestmove" is when the hard deadline was hit
+
+   overshoot = my_timer_elapsed_real(SearchCurrent[0]->timer) - SearchInput->time_limit_2;
+
+   if (SearchInput->time_is_limited && !SearchInput->infinite && overshoot >= 0.0) {
+      overshoot_add(overshoot);
+   }
+
    if (pv[0] == move && move_is_ok(pv[1])) {
       move_to_string(pv[1],ponder_string,256);
       send("bestmove %s ponder %s",move_string,ponder_string);
@@ -676,6 +1103,60 @@ static void send_best_move() {
    }
 }
 
+// overshoot_add()
+
+static void overshoot_add(double overshoot) {
+
+   double sorted[OvershootMax];
+   int nb;
+
+   ASSERT(overshoot>=0.0);
+
+   Overshoot[OvershootNb++ % OvershootMax] = overshoot;
+
+   if (!Debug) return;
+
+   // 99th percentile over the last searches, nearest rank
+
+   nb = (OvershootNb < OvershootMax) ? OvershootNb : OvershootMax;
+
+   memcpy(sorted,Overshoot,nb*sizeof(double));
+   qsort(sorted,nb,sizeof(double),overshoot_compare);
+
+   send("info string deadline overshoot %.3f ms p99 %.3f ms (%d searches)",overshoot*1000.0,sorted[(nb*99+99)/100-1]*1000.0,nb);
+}
+
+// overshoot_compare()
+
+static int overshoot_compare(const void * a, const void * b) {
+
+   double x = *((const double *) a);
+   double y = *((const double *) b);
+
+   return (x > y) - (x < y);
+}
+
+// hash_file_name()
+
+static const char * hash_file_name(const char string[]) {
+
+   const char * ptr;
+
+   ASSERT(string!=NULL);
+
+   // "savehash [file]" / "loadhash [file]", defaults to the "Hash File" option
+
+   ptr = strchr(string,' ');
+   while (ptr != NULL && *ptr == ' ') ptr++;
+
+   if (ptr != NULL && *ptr != '\0') return ptr;
+
+   ptr = option_get_string("Hash File");
+   if (my_string_empty(ptr) || my_string_equal(ptr,"<empty>")) ptr = "toga.hash";
+
+   return ptr;
+}
+
 // get()
 
 void get(char string[], int size) {
@@ -683,7 +1164,7 @@ void get(char string[], int size) {
    ASSERT(string!=NULL);
    ASSERT(size>=65536);
 
-   if (!my_file_read_line(stdin,string,size)) { // EOF
+   if (!input_get(string,size)) { // EOF
       exit(EXIT_SUCCESS);
    }
 }
@@ -23,6 +23,7 @@ extern  pthread_mutex_t CriticalSection;
 // functions
 
 extern void loop  ();
+extern void bench (int argc, char * argv[]);
 extern void event ();
 extern void book_parameter();
 
@@ -9,11 +9,11 @@
 #else
 #include <pthread.h>
 #include <errno.h>
+#include <time.h>
 #include <unistd.h>
 #endif
 
 
-#include <csetjmp>
 #include <cstring>
 
 #include "attack.h"
@@ -27,11 +27,13 @@
 #include "move_gen.h"
 #include "option.h"
 #include "pawn.h"
+#include "posix.h"
 #include "protocol.h"
 #include "pv.h"
 #include "search.h"
 #include "search_full.h"
 #include "sort.h"
+#include "thread.h"
 #include "trans.h"
 #include "util.h"
 #include "value.h"
@@ -41,6 +43,8 @@
 static const bool UseCpuTime = false; // false
 static const bool UseEvent = true; // true
 
+static const int TimerPeriod = 1; // ms between two clock checks of the main thread
+
 static const bool UseShortSearch = true;
 static const int ShortSearchDepth = 1;
 
@@ -61,15 +65,48 @@ static const bool UseBad = true;
 static const int BadThreshold = 50; // 50
 static const bool UseExtension = true;
 
-// variables
+// helper threads skip iterations in blocks so that they spread over
+// several depths instead of all searching the main thread's one
 
-static search_multipv_t save_multipv[MultiPVMax];
+static const int SkipNb = 20;
+static const int SkipSize[SkipNb]  = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+static const int SkipPhase[SkipNb] = { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
+
+// types
+
+struct pool_t { // helper threads, asleep between searches
 #ifdef _WIN32
-static HANDLE threat_handle[MaxThreads];
+   CRITICAL_SECTION lock;
+   CONDITION_VARIABLE start;
+   CONDITION_VARIABLE done;
+   CONDITION_VARIABLE tick;
+   HANDLE handle[MaxThreads];
+   HANDLE timer;
 #else
-static pthread_t threat_handle[MaxThreads];
-static my_sem_t thread_runnable[MaxThreads];
+   pthread_mutex_t lock;
+   pthread_cond_t start;
+   pthread_cond_t done;
+   pthread_cond_t tick;
+   pthread_t handle[MaxThreads];
+   pthread_t timer;
 #endif
+   int id[MaxThreads];
+   int thread_nb;
+   int generation; // bumped to start a search
+   int running; // helpers still in search_smp()
+   bool timing; // the timer thread is polling the main thread
+   bool exit;
+   double stop_time; // stop latency of the last search
+};
+
+// variables
+
+static bool UseSkip = true;
+static bool UseSplit = false;
+
+static search_multipv_t save_multipv[MultiPVMax];
+
+static pool_t Pool[1];
 
 int NumberThreads = 1;
 
@@ -77,18 +114,28 @@ int NumberThreads = 1;
 //CRITICAL_SECTION CriticalSection; 
 
 search_input_t SearchInput[1];
-search_info_t SearchInfo[MaxThreads][1];
-search_root_t SearchRoot[MaxThreads][1];
-search_current_t SearchCurrent[MaxThreads][1];
-search_best_t SearchBest[MaxThreads][MultiPVMax];
+search_info_t * SearchInfo[MaxThreads];
+search_root_t * SearchRoot[MaxThreads];
+search_current_t * SearchCurrent[MaxThreads];
+search_best_t * SearchBest[MaxThreads];
 
 // prototypes
 
 static void search_send_stat (int ThreadId);
+
+static void pool_resume      ();
+static void pool_wait        ();
+static void pool_loop        (int ThreadId);
+
+static void timer_set        (bool timing);
+static void timer_loop       ();
+
 #ifdef _WIN32
-unsigned __stdcall search_thread (void *param);
+static unsigned __stdcall search_thread (void * param);
+static unsigned __stdcall timer_thread  (void * param);
 #else
-void * search_thread (void *param);
+static void * search_thread (void * param);
+static void * timer_thread  (void * param);
 #endif
 
 // functions
@@ -115,23 +162,30 @@ void search_clear() {
 
    // SearchInput
 
+   SearchInput->board->history = SearchInput->history;
    SearchInput->infinite = false;
    SearchInput->depth_is_limited = false;
    SearchInput->depth_limit = 0;
    SearchInput->time_is_limited = false;
    SearchInput->time_limit_1 = 0.0;
    SearchInput->time_limit_2 = 0.0;
+   SearchInput->node_is_limited = false;
+   SearchInput->node_limit = 0;
 
    // SearchInfo
 
 	for (ThreadId = 0; ThreadId < NumberThreads; ThreadId++){
 		SearchInfo[ThreadId]->can_stop = false;
+		SearchInfo[ThreadId]->abort = false;
 		SearchInfo[ThreadId]->stop = false;
-		SearchInfo[ThreadId]->stopped = false;
-		SearchInfo[ThreadId]->exited = false;
+		SearchInfo[ThreadId]->poll = false;
 		SearchInfo[ThreadId]->check_nb = 10000; // was 100000
 		SearchInfo[ThreadId]->check_inc = 10000; // was 100000
 		SearchInfo[ThreadId]->last_time = 0.0;
+		SearchInfo[ThreadId]->split = NULL;
+		SearchInfo[ThreadId]->cut = NULL;
+		SearchInfo[ThreadId]->work = NULL;
+		SearchInfo[ThreadId]->idle = false;
 
 		// SearchBest
 
@@ -163,72 +217,319 @@ void search_clear() {
 		SearchCurrent[ThreadId]->cpu = 0.0;
 	}
 }
+
+// pool_create()
+
+void pool_create() {
+
+   int ThreadId;
+
+   // the helpers start asleep, see pool_loop()
+   // each one allocates its own context first (NUMA first touch)
+
 #ifdef _WIN32
-void start_suspend_threads(){
+   InitializeCriticalSection(&Pool->lock);
+   InitializeConditionVariable(&Pool->start);
+   InitializeConditionVariable(&Pool->done);
+   InitializeConditionVariable(&Pool->tick);
+#else
+   pthread_mutex_init(&Pool->lock,NULL);
+   pthread_cond_init(&Pool->start,NULL);
+   pthread_cond_init(&Pool->done,NULL);
+   pthread_cond_init(&Pool->tick,NULL);
+#endif
 
-   static int ThreadIds[MaxThreads];
-   static unsigned internalThreadIds[MaxThreads];
-   int i;
+   Pool->thread_nb = NumberThreads - 1;
+   Pool->generation = 0;
+   Pool->running = Pool->thread_nb;
+   Pool->timing = false;
+   Pool->exit = false;
+   Pool->stop_time = 0.0;
 
-   // start and suspend threads
+   for (ThreadId = 1; ThreadId < NumberThreads; ThreadId++) {
 
-   for (i = 1; i < NumberThreads; i++){
-	    ThreadIds[i-1] = i;
-		threat_handle[i-1] = (HANDLE) _beginthreadex( NULL, 0, &search_thread, &ThreadIds[i-1], CREATE_SUSPENDED, &internalThreadIds[i-1]);
+      Pool->id[ThreadId] = ThreadId;
+
+#ifdef _WIN32
+      Pool->handle[ThreadId] = (HANDLE) _beginthreadex(NULL,0,&search_thread,&Pool->id[ThreadId],0,NULL);
+      if (Pool->handle[ThreadId] == 0) my_fatal("pool_create(): _beginthreadex(): failed\n");
+#else
+      if (pthread_create(&Pool->handle[ThreadId],NULL,search_thread,&Pool->id[ThreadId]) != 0) {
+         my_fatal("pool_create(): pthread_create(): %s\n",strerror(errno));
+      }
+#endif
    }
 
+   // the timer thread, even without helpers
+
+#ifdef _WIN32
+   Pool->timer = (HANDLE) _beginthreadex(NULL,0,&timer_thread,NULL,0,NULL);
+   if (Pool->timer == 0) my_fatal("pool_create(): _beginthreadex(): failed\n");
+#else
+   if (pthread_create(&Pool->timer,NULL,timer_thread,NULL) != 0) {
+      my_fatal("pool_create(): pthread_create(): %s\n",strerror(errno));
+   }
+#endif
+
+   pool_wait();
 }
-void resume_threads(){
 
-   int i;
+// pool_destroy()
 
-   // resume threads
+void pool_destroy() {
 
-   for (i = 1; i < NumberThreads; i++){
-	    ResumeThread(threat_handle[i-1]);
+   int ThreadId;
+
+   // wake the helpers up for good and join them
+
+#ifdef _WIN32
+   EnterCriticalSection(&Pool->lock);
+   Pool->exit = true;
+   WakeAllConditionVariable(&Pool->start);
+   WakeConditionVariable(&Pool->tick);
+   LeaveCriticalSection(&Pool->lock);
+#else
+   pthread_mutex_lock(&Pool->lock);
+   Pool->exit = true;
+   pthread_cond_broadcast(&Pool->start);
+   pthread_cond_signal(&Pool->tick);
+   pthread_mutex_unlock(&Pool->lock);
+#endif
+
+   for (ThreadId = 1; ThreadId <= Pool->thread_nb; ThreadId++) {
+#ifdef _WIN32
+      WaitForSingleObject(Pool->handle[ThreadId],INFINITE);
+      CloseHandle(Pool->handle[ThreadId]);
+#else
+      pthread_join(Pool->handle[ThreadId],NULL);
+#endif
    }
+
+#ifdef _WIN32
+   WaitForSingleObject(Pool->timer,INFINITE);
+   CloseHandle(Pool->timer);
+#else
+   pthread_join(Pool->timer,NULL);
+#endif
+
+#ifdef _WIN32
+   DeleteCriticalSection(&Pool->lock);
+#else
+   pthread_cond_destroy(&Pool->start);
+   pthread_cond_destroy(&Pool->done);
+   pthread_cond_destroy(&Pool->tick);
+   pthread_mutex_destroy(&Pool->lock);
+#endif
+
+   Pool->thread_nb = 0;
 }
+
+// pool_resume()
+
+static void pool_resume() {
+
+#ifdef _WIN32
+   EnterCriticalSection(&Pool->lock);
+   Pool->running = Pool->thread_nb;
+   Pool->generation++;
+   WakeAllConditionVariable(&Pool->start);
+   LeaveCriticalSection(&Pool->lock);
 #else
-void start_suspend_threads(){
+   pthread_mutex_lock(&Pool->lock);
+   Pool->running = Pool->thread_nb;
+   Pool->generation++;
+   pthread_cond_broadcast(&Pool->start);
+   pthread_mutex_unlock(&Pool->lock);
+#endif
+}
 
-   static int ThreadIds[MaxThreads];
-   int i;
+// pool_wait()
 
-   // start and suspend threads
+static void pool_wait() {
 
-   for (i = 1; i < NumberThreads; i++){
-	    ThreadIds[i-1] = i;
-        my_sem_init(&(thread_runnable[i-1]),0);
-	    pthread_create(&(threat_handle[i-1]),NULL,
-			   search_thread,&(ThreadIds[i-1]));
+   // sleeps until the last helper has left search_smp()
+
+#ifdef _WIN32
+   EnterCriticalSection(&Pool->lock);
+   while (Pool->running > 0) SleepConditionVariableCS(&Pool->done,&Pool->lock,INFINITE);
+   LeaveCriticalSection(&Pool->lock);
+#else
+   pthread_mutex_lock(&Pool->lock);
+   while (Pool->running > 0) pthread_cond_wait(&Pool->done,&Pool->lock);
+   pthread_mutex_unlock(&Pool->lock);
+#endif
+}
+
+// pool_loop()
+
+static void pool_loop(int ThreadId) {
+
+   int generation;
+
+   ASSERT(ThreadId>0&&ThreadId<MaxThreads);
+
+   generation = 0;
+
+   thread_alloc(ThreadId);
+
+#ifdef _WIN32
+   EnterCriticalSection(&Pool->lock);
+   if (--Pool->running == 0) WakeConditionVariable(&Pool->done);
+#else
+   pthread_mutex_lock(&Pool->lock);
+   if (--Pool->running == 0) pthread_cond_signal(&Pool->done);
+#endif
+
+   while (true) {
+
+      // sleep until the next search
+
+      while (Pool->generation == generation && !Pool->exit) {
+#ifdef _WIN32
+         SleepConditionVariableCS(&Pool->start,&Pool->lock,INFINITE);
+#else
+         pthread_cond_wait(&Pool->start,&Pool->lock);
+#endif
+      }
+
+      if (Pool->exit) break;
+
+      generation = Pool->generation;
+
+#ifdef _WIN32
+      LeaveCriticalSection(&Pool->lock);
+#else
+      pthread_mutex_unlock(&Pool->lock);
+#endif
+
+      search_smp(ThreadId);
+
+#ifdef _WIN32
+      EnterCriticalSection(&Pool->lock);
+      if (--Pool->running == 0) WakeConditionVariable(&Pool->done);
+#else
+      pthread_mutex_lock(&Pool->lock);
+      if (--Pool->running == 0) pthread_cond_signal(&Pool->done);
+#endif
    }
 
+#ifdef _WIN32
+   LeaveCriticalSection(&Pool->lock);
+#else
+   pthread_mutex_unlock(&Pool->lock);
+#endif
+
+   thread_free(ThreadId);
 }
-void resume_threads(){
 
-   int i;
-   // resume threads
-   for (i = 1; i < NumberThreads; i++){
-       my_sem_post(&(thread_runnable[i-1]));
+// timer_set()
+
+static void timer_set(bool timing) {
+
+#ifdef _WIN32
+   EnterCriticalSection(&Pool->lock);
+   Pool->timing = timing;
+   WakeConditionVariable(&Pool->tick);
+   LeaveCriticalSection(&Pool->lock);
+#else
+   pthread_mutex_lock(&Pool->lock);
+   Pool->timing = timing;
+   pthread_cond_signal(&Pool->tick);
+   pthread_mutex_unlock(&Pool->lock);
+#endif
+}
+
+// timer_loop()
+
+static void timer_loop() {
+
+#ifndef _WIN32
+   struct timespec deadline;
+#endif
+
+   // during a search, makes the main thread look at the clock every
+   // TimerPeriod ms instead of every check_inc nodes, see search_check()
+
+#ifdef _WIN32
+   EnterCriticalSection(&Pool->lock);
+#else
+   pthread_mutex_lock(&Pool->lock);
+#endif
+
+   while (!Pool->exit) {
+
+      if (!Pool->timing) {
+#ifdef _WIN32
+         SleepConditionVariableCS(&Pool->tick,&Pool->lock,INFINITE);
+#else
+         pthread_cond_wait(&Pool->tick,&Pool->lock);
+#endif
+         continue;
+      }
+
+#ifdef _WIN32
+      SleepConditionVariableCS(&Pool->tick,&Pool->lock,TimerPeriod);
+#else
+      clock_gettime(CLOCK_REALTIME,&deadline);
+      deadline.tv_nsec += TimerPeriod * 1000000;
+      if (deadline.tv_nsec >= 1000000000) {
+         deadline.tv_sec++;
+         deadline.tv_nsec -= 1000000000;
+      }
+      pthread_cond_timedwait(&Pool->tick,&Pool->lock,&deadline);
+#endif
+
+      if (Pool->timing) SearchInfo[0]->poll = true;
    }
+
+#ifdef _WIN32
+   LeaveCriticalSection(&Pool->lock);
+#else
+   pthread_mutex_unlock(&Pool->lock);
+#endif
+}
+
+// search_thread()
+
+#ifdef _WIN32
+static unsigned __stdcall search_thread(void * param) {
+
+   pool_loop(*((int *) param));
+
+   return 0;
+}
+#else
+static void * search_thread(void * param) {
+
+   pool_loop(*((int *) param));
+
+   return NULL;
 }
 #endif
 
-// exit_threads() 
-
-void exit_threads() {
-  int ThreadId;
-  bool all_exited=false;
-  SearchInput->exit_engine=true; // hack
-  resume_threads();
-  while (!all_exited){
-    all_exited = true;
-    for (ThreadId = 1; ThreadId < NumberThreads; ThreadId++){
-      if (!SearchInfo[ThreadId]->exited)
-	all_exited = false;
-    }
-  }
-  SearchInput->exit_engine=false; // hack
+// timer_thread()
+
+#ifdef _WIN32
+static unsigned __stdcall timer_thread(void * param) {
+
+   timer_loop();
+
+   return 0;
+}
+#else
+static void * timer_thread(void * param) {
+
+   timer_loop();
+
+   return NULL;
+}
+#endif
+
+// pool_stop_time()
+
+double pool_stop_time() {
+
+   return Pool->stop_time;
 }
 
 
@@ -238,7 +539,7 @@ void search() {
 
    int move;
    int i;
-   bool all_stopped;
+   double start_time;
    int ThreadId; 
            
    for (i = 0; i < MultiPVMax; i++){
@@ -252,6 +553,8 @@ void search() {
    }
   
    SearchInput->multipv = option_get_int("MultiPV")-1;
+   UseSkip = option_get_bool("SMP Depth Skipping");
+   UseSplit = my_string_equal(option_get_string("SMP Mode"),"YBWC");
 
 	for (ThreadId = 0; ThreadId < NumberThreads; ThreadId++){
 		SearchCurrent[ThreadId]->multipv = 0;
@@ -270,12 +573,12 @@ void search() {
 
          // play book move
 
-         SearchBest[0][SearchCurrent[ThreadId]->multipv].move = move;
-         SearchBest[0][SearchCurrent[ThreadId]->multipv].value = 1;
-         SearchBest[0][SearchCurrent[ThreadId]->multipv].flags = SearchExact;
-         SearchBest[0][SearchCurrent[ThreadId]->multipv].depth = 1;
-         SearchBest[0][SearchCurrent[ThreadId]->multipv].pv[0] = move;
-         SearchBest[0][SearchCurrent[ThreadId]->multipv].pv[1] = MoveNone;
+         SearchBest[0][SearchCurrent[0]->multipv].move = move;
+         SearchBest[0][SearchCurrent[0]->multipv].value = 1;
+         SearchBest[0][SearchCurrent[0]->multipv].flags = SearchExact;
+         SearchBest[0][SearchCurrent[0]->multipv].depth = 1;
+         SearchBest[0][SearchCurrent[0]->multipv].pv[0] = move;
+         SearchBest[0][SearchCurrent[0]->multipv].pv[1] = MoveNone;
 
          search_update_best(0);
 
@@ -296,79 +599,57 @@ void search() {
       SearchInput->depth_limit = 4; // was 1
    }
 
+   trans_wait(Trans); // background resize
    trans_inc_date(Trans);
 
+   // a node budget below the regular check interval is checked on time
+
+   if (SearchInput->node_is_limited && SearchInput->node_limit / NumberThreads < SearchInfo[0]->check_nb) {
+      SearchInfo[0]->check_nb = int(SearchInput->node_limit / NumberThreads);
+      if (SearchInfo[0]->check_nb < 1) SearchInfo[0]->check_nb = 1;
+   }
+
    // resume threads
 
-   resume_threads();
+   timer_set(true);
+   pool_resume();
 
-   //SearchInfo_smp->stop = true;
    search_smp(0);
-   for (ThreadId = 1; ThreadId < NumberThreads; ThreadId++){ // stop threads
-		SearchInfo[ThreadId]->stop = true;
-   }
 
-   all_stopped = false;
-   while (!all_stopped){
-	   all_stopped = true;
-	   for (ThreadId = 1; ThreadId < NumberThreads; ThreadId++){
-			if (!SearchInfo[ThreadId]->stopped)
-				all_stopped = false;
-	   }
+   timer_set(false);
+
+   // stop threads, they poll right away
+
+   start_time = now_real();
+
+   for (ThreadId = 1; ThreadId < NumberThreads; ThreadId++){
+		SearchInfo[ThreadId]->stop = true;
+		SearchInfo[ThreadId]->poll = true;
    }
-}
 
-#ifdef _WIN32
-unsigned __stdcall search_thread (void *param) {
+   search_full_wake(); // idle YBWC helpers
 
-	int ThreadId = *((int*)param);
-	SearchInfo[ThreadId]->exited= false;
+   pool_wait();
 
-	while (!SearchInput->exit_engine){
-		search_smp(ThreadId);
-		SearchInfo[ThreadId]->stopped = true;
-		SuspendThread(threat_handle[ThreadId-1]);
-	}
-	SearchInfo[ThreadId]->exited= true;
-	_endthreadex( 0 );
-	return 0;
-}
-#else
-void * search_thread (void *param) {
-
-	int ThreadId = *((int*)param);
-	SearchInfo[ThreadId]->exited= false;
-	my_sem_wait(&(thread_runnable[ThreadId-1]));
-	while (!SearchInput->exit_engine){
-	  search_smp(ThreadId);
-	  SearchInfo[ThreadId]->stopped = true;
-	  my_sem_wait(&(thread_runnable[ThreadId-1]));
-	}
-	SearchInfo[ThreadId]->exited= true;
-	return NULL;
+   Pool->stop_time = now_real() - start_time;
 }
-#endif
+
 
 // search_smp()
 
 void search_smp(int ThreadId) {
 
-   int depth;
-   int i;
+   int depth, max_depth;
    int delta, alpha, beta;
    int last_move;
+   int skip;
    bool search_ready;
    sint64 node_nb;
    double speed;
         
    // SearchInfo
 
-   if (setjmp(SearchInfo[ThreadId]->buf) != 0) {
-      ASSERT(SearchInfo[ThreadId]->can_stop);
-      ASSERT(SearchBest[ThreadId]->move!=MoveNone);
-      search_update_current(ThreadId);
-      return;
-   }
+   SearchInfo[ThreadId]->abort = false;
 
    // SearchRoot
 
@@ -376,7 +657,7 @@ void search_smp(int ThreadId) {
 
    // SearchCurrent
 
-   board_copy(SearchCurrent[ThreadId]->board,SearchInput->board);
+   board_fork(SearchCurrent[ThreadId]->board,SearchInput->board,SearchCurrent[ThreadId]->history);
    my_timer_reset(SearchCurrent[ThreadId]->timer);
    my_timer_start(SearchCurrent[ThreadId]->timer);
 
@@ -403,6 +684,8 @@ void search_smp(int ThreadId) {
    
 
    if (ThreadId == 0){ // main thread
+	   alpha = -ValueInf; // set again below, for the compiler
+	   beta = +ValueInf;
 	   for (depth = 1; depth < DepthMax; depth++) {
 	   	   delta = 16; 
 		   for (SearchCurrent[ThreadId]->multipv = 0; SearchCurrent[ThreadId]->multipv <= SearchInput->multipv; SearchCurrent[ThreadId]->multipv++){
@@ -412,7 +695,7 @@ void search_smp(int ThreadId) {
 			  SearchRoot[ThreadId]->bad_1 = false;
 			  SearchRoot[ThreadId]->change = false;
 
-			  board_copy(SearchCurrent[ThreadId]->board,SearchInput->board);
+			  board_fork(SearchCurrent[ThreadId]->board,SearchInput->board,SearchCurrent[ThreadId]->history);
 			  
 			  // Aspiration windows (JD)
 			  
@@ -428,6 +711,13 @@ void search_smp(int ThreadId) {
     		    } else {
     			   search_full_root(SearchRoot[ThreadId]->list,SearchCurrent[ThreadId]->board,alpha,beta,depth,SearchNormal,ThreadId);
     		    }
+
+    		    if (SearchInfo[ThreadId]->abort) { // stopped, see search_check()
+    		       ASSERT(SearchInfo[ThreadId]->can_stop);
+    		       ASSERT(SearchBest[ThreadId]->move!=MoveNone);
+    		       search_update_current(ThreadId);
+    		       return;
+    		    }
     		    
     		    // Aspiration windows
     		    
@@ -454,17 +744,13 @@ void search_smp(int ThreadId) {
               last_move = SearchBest[ThreadId]->move;
 			  search_update_current(ThreadId);
 
-			  node_nb = 0;
-			  speed = 0;
-			  
-			  // calculate nodes/speed
-			  for (i = 0; i < NumberThreads; i++){
-				node_nb += SearchCurrent[i]->node_nb;
-				speed += SearchCurrent[i]->speed;
-			  }
+			  // all threads
+
+			  search_total(&node_nb,&max_depth);
+			  speed = (SearchCurrent[ThreadId]->time > 0.0) ? double(node_nb) / SearchCurrent[ThreadId]->time : 0.0;
 
 			  if (DispDepthEnd && SearchCurrent[ThreadId]->multipv == SearchInput->multipv) {
-				 send("info depth %d seldepth %d time %.0f nodes " S64_FORMAT " nps %.0f",depth,SearchCurrent[ThreadId]->max_depth,SearchCurrent[ThreadId]->time*1000.0,node_nb,speed);
+				 send("info depth %d seldepth %d time %.0f nodes " S64_FORMAT " nps %.0f",depth,max_depth,SearchCurrent[ThreadId]->time*1000.0,node_nb,speed);
 			  }
 
 			  // update search info
@@ -498,6 +784,11 @@ void search_smp(int ThreadId) {
 				 SearchRoot[ThreadId]->flag = true;
 			  }
 
+			  if (SearchInput->node_is_limited
+			   && node_nb >= SearchInput->node_limit) {
+				 SearchRoot[ThreadId]->flag = true;
+			  }
+
 			  if (UseEasy
 			   && SearchInput->time_is_limited
 			   && SearchCurrent[ThreadId]->time >= SearchInput->time_limit_1 * EasyRatio
@@ -525,12 +816,24 @@ void search_smp(int ThreadId) {
 			   break;
 	   }
    }
+   else if (UseSplit) { // YBWC: helpers only work at split points
+	   SearchInfo[ThreadId]->can_stop = true;
+	   search_full_idle(ThreadId);
+   }
    else {
+	   skip = (ThreadId - 1) % SkipNb;
+	   alpha = -ValueInf; // the first iterations may be skipped
+	   beta = +ValueInf;
 	   for (depth = 1; depth < DepthMax; depth++) {
+
+		  // depth skipping, by thread and depth only (ply_nb is the 50-move counter)
+
+		  if (UseSkip && ((depth + SkipPhase[skip]) / SkipSize[skip]) % 2 != 0) continue;
+
 	   	  delta = 16; 
 		  SearchInfo[ThreadId]->can_stop = true;
 		  
-		  board_copy(SearchCurrent[ThreadId]->board,SearchInput->board);
+		  board_fork(SearchCurrent[ThreadId]->board,SearchInput->board,SearchCurrent[ThreadId]->history);
 
 		  // Aspiration windows
 		  if (depth <= 4){	// Try other values	  
@@ -545,6 +848,11 @@ void search_smp(int ThreadId) {
 		    } else {
 			   search_full_root(SearchRoot[ThreadId]->list,SearchCurrent[ThreadId]->board,alpha,beta,depth,SearchNormal,ThreadId);
 		    }
+
+		    if (SearchInfo[ThreadId]->abort) {
+		       search_update_current(ThreadId);
+		       return;
+		    }
 		    
 		    if (value_is_mate(SearchBest[ThreadId]->value)) break;
 		    
@@ -575,7 +883,7 @@ void search_update_best(int ThreadId) {
 
    int move, value, flags, depth, max_depth;
    const mv_t * pv;
-   double time;
+   double time, speed;
    sint64 node_nb;
    int mate, i, z;
    bool found;
@@ -601,9 +909,9 @@ void search_update_best(int ThreadId) {
       depth = SearchBest[ThreadId][SearchCurrent[ThreadId]->multipv].depth;
       pv = SearchBest[ThreadId][SearchCurrent[ThreadId]->multipv].pv;
 
-      max_depth = SearchCurrent[ThreadId]->max_depth;
+      search_total(&node_nb,&max_depth); // helpers included
       time = SearchCurrent[ThreadId]->time;
-      node_nb = SearchCurrent[ThreadId]->node_nb;
+      speed = (time > 0.0) ? double(node_nb) / time : 0.0;
 
       move_to_string(move,move_string,256);
       pv_to_string(pv,pv_string,512);
@@ -617,6 +925,7 @@ void search_update_best(int ThreadId) {
 		  save_multipv[SearchCurrent[ThreadId]->multipv].value = value;
 		  save_multipv[SearchCurrent[ThreadId]->multipv].time = time*1000.0;
 		  save_multipv[SearchCurrent[ThreadId]->multipv].node_nb = node_nb;
+		  save_multipv[SearchCurrent[ThreadId]->multipv].speed = speed;
 		  strcpy(save_multipv[SearchCurrent[ThreadId]->multipv].pv_string,pv_string); 
 	  }
 	  else{
@@ -636,6 +945,7 @@ void search_update_best(int ThreadId) {
 				  save_multipv[z].value = save_multipv[z-1].value;
 				  save_multipv[z].time = save_multipv[z-1].time;
 				  save_multipv[z].node_nb = save_multipv[z-1].node_nb;
+				  save_multipv[z].speed = save_multipv[z-1].speed;
 				  strcpy(save_multipv[z].pv_string,save_multipv[z-1].pv_string); 
 			  }
 			  
@@ -645,6 +955,7 @@ void search_update_best(int ThreadId) {
 		      save_multipv[i].value = value;
 		      save_multipv[i].time = time*1000.0;
 		      save_multipv[i].node_nb = node_nb;
+		      save_multipv[i].speed = speed;
 		      strcpy(save_multipv[i].pv_string,pv_string); 
 			  
 		  }
@@ -655,6 +966,7 @@ void search_update_best(int ThreadId) {
 			  save_multipv[SearchCurrent[ThreadId]->multipv].value = value;
 			  save_multipv[SearchCurrent[ThreadId]->multipv].time = time*1000.0;
 			  save_multipv[SearchCurrent[ThreadId]->multipv].node_nb = node_nb;
+			  save_multipv[SearchCurrent[ThreadId]->multipv].speed = speed;
 			  strcpy(save_multipv[SearchCurrent[ThreadId]->multipv].pv_string,pv_string); 
 		  }
 	  }
@@ -668,11 +980,11 @@ void search_update_best(int ThreadId) {
 
 			  if (false) {
 				 } else if (flags == SearchExact) {
-					send("info multipv %d depth %d seldepth %d score cp %d time %.0f nodes " S64_FORMAT " pv %s",i+1,save_multipv[i].depth,save_multipv[i].max_depth,save_multipv[i].value,save_multipv[i].time,save_multipv[i].node_nb,save_multipv[i].pv_string);
+					send("info multipv %d depth %d seldepth %d score cp %d time %.0f nodes " S64_FORMAT " nps %.0f pv %s",i+1,save_multipv[i].depth,save_multipv[i].max_depth,save_multipv[i].value,save_multipv[i].time,save_multipv[i].node_nb,save_multipv[i].speed,save_multipv[i].pv_string);
 				 } else if (flags == SearchLower) {
-					send("info multipv %d depth %d seldepth %d score cp %d lowerbound time %.0f nodes " S64_FORMAT " pv %s",i+1,save_multipv[i].depth,save_multipv[i].max_depth,save_multipv[i].value,save_multipv[i].time,save_multipv[i].node_nb,save_multipv[i].pv_string);
+					send("info multipv %d depth %d seldepth %d score cp %d lowerbound time %.0f nodes " S64_FORMAT " nps %.0f pv %s",i+1,save_multipv[i].depth,save_multipv[i].max_depth,save_multipv[i].value,save_multipv[i].time,save_multipv[i].node_nb,save_multipv[i].speed,save_multipv[i].pv_string);
 				 } else if (flags == SearchUpper) {
-					send("info multipv %d depth %d seldepth %d score cp %d upperbound time %.0f nodes " S64_FORMAT " pv %s",i+1,save_multipv[i].depth,save_multipv[i].max_depth,save_multipv[i].value,save_multipv[i].time,save_multipv[i].node_nb,save_multipv[i].pv_string);
+					send("info multipv %d depth %d seldepth %d score cp %d upperbound time %.0f nodes " S64_FORMAT " nps %.0f pv %s",i+1,save_multipv[i].depth,save_multipv[i].max_depth,save_multipv[i].value,save_multipv[i].time,save_multipv[i].node_nb,save_multipv[i].speed,save_multipv[i].pv_string);
 				 }
 
 			  } else {
@@ -681,11 +993,11 @@ void search_update_best(int ThreadId) {
 
 				 if (false) {
 				 } else if (flags == SearchExact) {
-					send("info multipv %d depth %d seldepth %d score mate %d time %.0f nodes " S64_FORMAT " pv %s",i+1,save_multipv[i].depth,save_multipv[i].max_depth,save_multipv[i].mate,save_multipv[i].time,save_multipv[i].node_nb,save_multipv[i].pv_string);
+					send("info multipv %d depth %d seldepth %d score mate %d time %.0f nodes " S64_FORMAT " nps %.0f pv %s",i+1,save_multipv[i].depth,save_multipv[i].max_depth,save_multipv[i].mate,save_multipv[i].time,save_multipv[i].node_nb,save_multipv[i].speed,save_multipv[i].pv_string);
 				 } else if (flags == SearchLower) {
-					send("info multipv %d depth %d seldepth %d score mate %d lowerbound time %.0f nodes " S64_FORMAT " pv %s",i+1,save_multipv[i].depth,save_multipv[i].max_depth,save_multipv[i].mate,save_multipv[i].time,save_multipv[i].node_nb,save_multipv[i].pv_string);
+					send("info multipv %d depth %d seldepth %d score mate %d lowerbound time %.0f nodes " S64_FORMAT " nps %.0f pv %s",i+1,save_multipv[i].depth,save_multipv[i].max_depth,save_multipv[i].mate,save_multipv[i].time,save_multipv[i].node_nb,save_multipv[i].speed,save_multipv[i].pv_string);
 				 } else if (flags == SearchUpper) {
-					send("info multipv %d depth %d seldepth %d score mate %d upperbound time %.0f nodes " S64_FORMAT " pv %s",i+1,save_multipv[i].depth,save_multipv[i].max_depth,save_multipv[i].mate,save_multipv[i].time,save_multipv[i].node_nb,save_multipv[i].pv_string);
+					send("info multipv %d depth %d seldepth %d score mate %d upperbound time %.0f nodes " S64_FORMAT " nps %.0f pv %s",i+1,save_multipv[i].depth,save_multipv[i].max_depth,save_multipv[i].mate,save_multipv[i].time,save_multipv[i].node_nb,save_multipv[i].speed,save_multipv[i].pv_string);
 				 }
 			  }
 		  }
@@ -768,15 +1080,62 @@ void search_update_current(int ThreadId) {
    SearchCurrent[ThreadId]->cpu = cpu;
 }
 
+// search_total()
+
+void search_total(sint64 * node_nb, int * max_depth) {
+
+   int ThreadId;
+   int height;
+
+   ASSERT(node_nb!=NULL);
+   ASSERT(max_depth!=NULL);
+
+   // read the helpers' counters on the fly, without locking: each one has a
+   // single writer and a slightly stale value is fine for reporting
+
+   *node_nb = 0;
+   *max_depth = 0;
+
+   for (ThreadId = 0; ThreadId < NumberThreads; ThreadId++) {
+      *node_nb += *((volatile sint64 *) &SearchCurrent[ThreadId]->node_nb);
+      height = *((volatile int *) &SearchCurrent[ThreadId]->max_depth);
+      if (height > *max_depth) *max_depth = height;
+   }
+}
+
 // search_check()
 
 void search_check(int ThreadId) {
 
+   sint64 node_nb, node_left;
+   int max_depth;
+
+   // node- or timer-driven, see full_search()
+
+   if (SearchInfo[ThreadId]->check_nb <= 0) SearchInfo[ThreadId]->check_nb += SearchInfo[ThreadId]->check_inc;
+   SearchInfo[ThreadId]->poll = false;
+
 	if (ThreadId == 0){
 		search_send_stat(ThreadId);
 
 	   if (UseEvent) event();
 
+	   if (SearchInput->node_is_limited) {
+
+		  // the budget covers all threads; the next check comes when the
+		  // main thread's share of what is left is used up, so that a
+		  // single thread stops on the exact node
+
+		  search_total(&node_nb,&max_depth);
+		  node_left = (SearchInput->node_limit - node_nb) / NumberThreads;
+
+		  if (node_nb >= SearchInput->node_limit) {
+			 SearchRoot[ThreadId]->flag = true;
+		  } else if (node_left < SearchInfo[ThreadId]->check_nb) {
+			 SearchInfo[ThreadId]->check_nb = (node_left > 0) ? int(node_left) : 1;
+		  }
+	   }
+
 	   if (SearchInput->depth_is_limited
 		&& SearchRoot[ThreadId]->depth > SearchInput->depth_limit) {
 		  SearchRoot[ThreadId]->flag = true;
@@ -797,12 +1156,14 @@ void search_check(int ThreadId) {
 
 	   if (SearchInfo[ThreadId]->can_stop 
 		&& (SearchInfo[ThreadId]->stop || (SearchRoot[ThreadId]->flag && !SearchInput->infinite))) {
-		  longjmp(SearchInfo[ThreadId]->buf,1);
+		  SearchInfo[ThreadId]->cut = NULL;
+		  SearchInfo[ThreadId]->abort = true;
 	   }
 	}
 	else{
 		if (SearchInfo[ThreadId]->stop){
-		  longjmp(SearchInfo[ThreadId]->buf,1);
+		  SearchInfo[ThreadId]->cut = NULL;
+		  SearchInfo[ThreadId]->abort = true;
 	   }
 	}
 }
@@ -812,8 +1173,10 @@ void search_check(int ThreadId) {
 static void search_send_stat(int ThreadId) {
 
    double time, speed, cpu;
-   sint64 node_nb;
-   int i;
+   sint64 node_nb, read_nb, read_hit;
+   int max_depth;
+   int i, pos;
+   char string[4096];
 
    search_update_current(ThreadId);
 
@@ -822,18 +1185,25 @@ static void search_send_stat(int ThreadId) {
       SearchInfo[ThreadId]->last_time = SearchCurrent[ThreadId]->time;
 
       time = SearchCurrent[ThreadId]->time;
-      speed = SearchCurrent[ThreadId]->speed;
       cpu = SearchCurrent[ThreadId]->cpu;
-	  node_nb = 0;
-	  speed = 0;
-	  for (i = 0; i < NumberThreads; i++){
-		node_nb += SearchCurrent[ThreadId]->node_nb;
-		speed += SearchCurrent[ThreadId]->speed;
-	  }
 
-      send("info time %.0f nodes " S64_FORMAT " nps %.0f cpuload %.0f",time*1000.0,node_nb,speed,cpu*1000.0);
+      search_total(&node_nb,&max_depth);
+      speed = (time > 0.0) ? double(node_nb) / time : 0.0;
+
+      send("info time %.0f nodes " S64_FORMAT " nps %.0f cpuload %.0f seldepth %d",time*1000.0,node_nb,speed,cpu*1000.0,max_depth);
 
       trans_stats(Trans);
+
+      // per-thread speed and hash hits, all threads started together
+
+      trans_hits(Trans,&read_nb,&read_hit);
+
+      pos = sprintf(string,"info string hash probes " S64_FORMAT " hits " S64_FORMAT " (%.1f%%) nps",read_nb,read_hit,(read_nb>0)?double(read_hit)*100.0/double(read_nb):0.0);
+      for (i = 0; i < NumberThreads; i++) {
+         pos += sprintf(&string[pos]," %.0f",double(*((volatile sint64 *) &SearchCurrent[i]->node_nb))/time);
+      }
+
+      send("%s",string);
    }
 }
 
@@ -6,8 +6,6 @@
 
 // includes
 
-#include <csetjmp>
-
 #include "board.h"
 #include "list.h"
 #include "move.h"
@@ -32,6 +30,8 @@ const int SearchExact   = 3;
 
 // types
 
+struct split_t;
+
 struct search_multipv_t {
    int mate;
    int depth;
@@ -39,6 +39,7 @@ struct search_multipv_t {
    int value;
    double time;
    sint64 node_nb;
+   double speed;
    char pv_string[512];
 
 };
@@ -52,26 +53,31 @@ struct search_param_t {
 
 struct search_input_t {
    board_t board[1];
+   history_t history[1]; // key history of the game, see board_fork()
    list_t list[1];
    bool infinite;
    bool depth_is_limited;
    int depth_limit;
    int multipv;
-   volatile bool exit_engine;
    bool time_is_limited;
    double time_limit_1;
    double time_limit_2;
+   bool node_is_limited;
+   sint64 node_limit;
 };
 
 struct search_info_t {
-   jmp_buf buf;
    bool can_stop;
+   bool abort; // unwinding, see search_check()
    volatile bool stop;
-   volatile bool stopped;
-  volatile bool exited;
+   volatile bool poll; // set by the timer thread or on stop, see search_check()
    int check_nb;
    int check_inc;
    double last_time;
+   split_t * split; // innermost split point (YBWC)
+   split_t * cut; // split point being unwound to, NULL = whole search
+   split_t * volatile work;
+   volatile bool idle;
 };
 
 struct search_root_t {
@@ -98,6 +104,7 @@ struct search_best_t {
 
 struct search_current_t {
    board_t board[1];
+   history_t history[1]; // key history of the thread's board
    my_timer_t timer[1];
    int max_depth;
    int multipv;
@@ -115,10 +122,10 @@ struct search_current_t {
 // variables
 
 extern search_input_t SearchInput[1];
-extern search_info_t SearchInfo[MaxThreads][1];
-extern search_best_t SearchBest[MaxThreads][MultiPVMax];
-extern search_root_t SearchRoot[MaxThreads][1];
-extern search_current_t SearchCurrent[MaxThreads][1];
+extern search_info_t * SearchInfo[MaxThreads]; // point into Thread[], see thread.h
+extern search_best_t * SearchBest[MaxThreads]; // [MultiPVMax]
+extern search_root_t * SearchRoot[MaxThreads];
+extern search_current_t * SearchCurrent[MaxThreads];
 extern int NumberThreads;
 
 // functions
@@ -133,12 +140,13 @@ extern void search_smp            (int ThreadId);
 extern void search_update_best    (int ThreadId);
 extern void search_update_root    (int ThreadId);
 extern void search_update_current (int ThreadId);
+extern void search_total          (sint64 * node_nb, int * max_depth);
 
 extern void search_check          (int ThreadId);
 
-extern void start_suspend_threads();
-extern void resume_threads();
-extern void exit_threads();
+extern void pool_create           ();
+extern void pool_destroy          ();
+extern double pool_stop_time      ();
 
 #endif // !defined SEARCH_H
 
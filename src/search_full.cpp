@@ -2,6 +2,14 @@
 
 // includes
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <cstring>
 #include <math.h>
 
 #include "pawn.h"
@@ -10,6 +18,7 @@
 #include "colour.h"
 #include "eval.h"
 #include "list.h"
+#include "material.h"
 #include "move.h"
 #include "move_check.h"
 #include "move_do.h"
@@ -29,11 +38,32 @@
 #define ABS(x) ((x)<0?-(x):(x))
 #define MIN(X, Y)  ((X) < (Y) ? (X) : (Y))
 
+#ifdef _WIN32
+#  define LOCK_INIT(lock) InitializeCriticalSection(lock)
+#  define LOCK_FREE(lock) DeleteCriticalSection(lock)
+#  define LOCK(lock)      EnterCriticalSection(lock)
+#  define UNLOCK(lock)    LeaveCriticalSection(lock)
+#  define COND_INIT(cond) InitializeConditionVariable(cond)
+#  define COND_FREE(cond)
+#  define COND_WAIT(cond,lock) SleepConditionVariableCS(cond,lock,INFINITE)
+#  define COND_SIGNAL(cond) WakeAllConditionVariable(cond)
+#else
+#  define LOCK_INIT(lock) pthread_mutex_init(lock,NULL)
+#  define LOCK_FREE(lock) pthread_mutex_destroy(lock)
+#  define LOCK(lock)      pthread_mutex_lock(lock)
+#  define UNLOCK(lock)    pthread_mutex_unlock(lock)
+#  define COND_INIT(cond) pthread_cond_init(cond,NULL)
+#  define COND_FREE(cond) pthread_cond_destroy(cond)
+#  define COND_WAIT(cond,lock) pthread_cond_wait(cond,lock)
+#  define COND_SIGNAL(cond) pthread_cond_broadcast(cond)
+#endif
+
 // constants and variables
 
 // main search
 
 static const bool UseDistancePruning = true;
+static const bool UseCycle = true; // upcoming repetitions, see board_has_cycle()
 
 // transposition table
 
@@ -95,12 +125,68 @@ static const int MoveCountLimit[6] = {0, 4, 7, 12, 19, 28};
 static /* const */ bool UseDelta = true; // false
 static /* const */ int DeltaMargin = 50;
 
+// parallel search (YBWC)
+
+static /* const */ bool UseSplit = false;
+static const int SplitDepth = 4;
+static const int SplitMax = 8; // nested split points per thread
+
 // misc
 
 static const int NodeAll = -1;
 static const int NodePV  =  0;
 static const int NodeCut = +1;
 
+// types
+
+#ifdef _WIN32
+typedef CRITICAL_SECTION lock_t;
+typedef CONDITION_VARIABLE cond_t;
+#else
+typedef pthread_mutex_t lock_t;
+typedef pthread_cond_t cond_t;
+#endif
+
+struct split_t {
+   lock_t lock[1];
+   cond_t done[1]; // the master sleeps until its slaves have left
+   split_t * parent;
+   int master;
+   volatile int slave_nb;
+   volatile bool stop;
+   board_t board[1];
+   history_t history[1];
+   attack_t attack[1];
+   sort_t sort[1];
+   bool sort_end;
+   int beta;
+   int depth;
+   int height;
+   int node_type;
+   bool cut_node;
+   bool extended;
+   bool in_check;
+   bool single_reply;
+   bool trans_reduction;
+   volatile int alpha;
+   volatile int best_value;
+   int best_move;
+   int played_nb;
+   int quiet_move_count;
+   bool good_cap;
+   mv_t played[256];
+   mv_t pv[HeightMax];
+};
+
+// variables
+
+static split_t * SplitPoint[MaxThreads]; // [SplitMax], see search_full_alloc()
+static int SplitNb[MaxThreads];
+
+static lock_t SplitLock[1];
+static cond_t SplitWake[1]; // idle threads sleep until attached or stopped
+static volatile int IdleNb;
+
 // macros
 
 #define NODE_OPP(type)     (-(type))
@@ -119,7 +205,7 @@ static int  full_new_depth       (int depth, int move, board_t * board, bool sin
 static bool do_null              (const board_t * board);
 static bool do_ver               (const board_t * board);
 
-static void pv_fill              (const mv_t pv[], board_t * board);
+static void pv_fill              (const mv_t pv[], board_t * board, int ThreadId);
 
 static bool move_is_dangerous    (int move, const board_t * board);
 static bool capture_is_dangerous (int move, const board_t * board);
@@ -131,8 +217,75 @@ static bool is_passed		     (const board_t * board, int to);
 
 static bool pawn_is_endgame      (int move, const board_t * board);
 
+static void prefetch_move        (const board_t * board, int move, int ThreadId);
+
+static bool full_split           (board_t * board, const sort_t * sort, const attack_t * attack, int * alpha, int beta, int depth, int height, int node_type, bool cut_node, bool extended, bool in_check, bool single_reply, int * best_value, int * best_move, mv_t pv[], mv_t played[], int * played_nb, bool * good_cap, int * quiet_move_count, int ThreadId);
+static void split_search         (split_t * sp, int ThreadId);
+static void split_loop           (split_t * sp, board_t * board, int ThreadId);
+static void split_leave          (split_t * sp, split_t * old_split, bool abort, int ThreadId);
+static void split_check          (int ThreadId);
+
 // functions
 
+// search_full_split_init()
+
+void search_full_split_init() {
+
+   LOCK_INIT(SplitLock);
+   COND_INIT(SplitWake);
+
+   IdleNb = 0;
+}
+
+// search_full_wake()
+
+void search_full_wake() {
+
+   // idle threads check their stop flag again
+
+   LOCK(SplitLock);
+   COND_SIGNAL(SplitWake);
+   UNLOCK(SplitLock);
+}
+
+// search_full_alloc()
+
+void search_full_alloc(int ThreadId) {
+
+   int i;
+
+   ASSERT(ThreadId>=0&&ThreadId<MaxThreads);
+
+   // split points are big, only threads that exist get some
+
+   SplitPoint[ThreadId] = (split_t *) my_malloc_aligned(SplitMax*sizeof(split_t),64);
+
+   for (i = 0; i < SplitMax; i++) {
+      LOCK_INIT(SplitPoint[ThreadId][i].lock);
+      COND_INIT(SplitPoint[ThreadId][i].done);
+   }
+
+   SplitNb[ThreadId] = 0;
+}
+
+// search_full_free()
+
+void search_full_free(int ThreadId) {
+
+   int i;
+
+   ASSERT(ThreadId>=0&&ThreadId<MaxThreads);
+   ASSERT(SplitNb[ThreadId]==0);
+
+   for (i = 0; i < SplitMax; i++) {
+      LOCK_FREE(SplitPoint[ThreadId][i].lock);
+      COND_FREE(SplitPoint[ThreadId][i].done);
+   }
+
+   my_free_aligned(SplitPoint[ThreadId]);
+   SplitPoint[ThreadId] = NULL;
+}
+
 // search_full_init()
 
 void search_full_init(list_t * list, board_t * board, int ThreadId) {
@@ -207,6 +360,13 @@ void search_full_init(list_t * list, board_t * board, int ThreadId) {
    UseDelta = option_get_bool("Delta Pruning");
    DeltaMargin = option_get_int("Delta Margin");
 
+   // parallel-search options
+
+   UseSplit = NumberThreads > 1 && my_string_equal(option_get_string("SMP Mode"),"YBWC");
+
+   SplitNb[ThreadId] = 0;
+   SearchInfo[ThreadId]->split = NULL;
+
    // quiescence-search options
 
    SearchCurrent[ThreadId]->CheckNb = option_get_int("Quiescence Check Plies");
@@ -224,7 +384,7 @@ void search_full_init(list_t * list, board_t * board, int ThreadId) {
    // basic sort
 
    trans_move = MoveNone;
-   if (UseTrans) trans_retrieve(Trans,&found_entry,board->key,&trans_move,&trans_depth,&trans_flags,&trans_value);
+   if (UseTrans) trans_retrieve(Trans,&found_entry,board->key,&trans_move,&trans_depth,&trans_flags,&trans_value,ThreadId);
    note_moves(list,board,0,trans_move,ThreadId);
    list_sort(list);
 }
@@ -248,6 +408,8 @@ int search_full_root(list_t * list, board_t * board, int a, int b, int depth, in
 
    value = full_root(list,board,a,b,depth,0,search_type, ThreadId);
 
+   if (SearchInfo[ThreadId]->abort) return ValueNone;
+
    ASSERT(value_is_ok(value));
    ASSERT(LIST_VALUE(list,0)==value);
 
@@ -328,7 +490,7 @@ static int full_root(list_t * list, board_t * board, int alpha, int beta, int de
 		  value = -full_search(board,-beta,-alpha,new_depth,height+1,new_pv,NodePV,cap_extended,ThreadId);
       } else { // other moves
          value = -full_search(board,-alpha-1,-alpha,new_depth,height+1,new_pv,NodeCut,cap_extended,ThreadId);
-         if (value > alpha) { // && value < beta
+         if (value > alpha && !SearchInfo[ThreadId]->abort) { // && value < beta
             SearchRoot[ThreadId]->change = true;
             SearchRoot[ThreadId]->easy = false;
             SearchRoot[ThreadId]->flag = false;
@@ -339,6 +501,8 @@ static int full_root(list_t * list, board_t * board, int alpha, int beta, int de
 
       move_undo(board,move,undo);
 
+      if (SearchInfo[ThreadId]->abort) return ValueNone;
+
       if (value <= alpha) { // upper bound
          list->value[i] = old_alpha;
       } else if (value >= beta) { // lower bound
@@ -381,7 +545,7 @@ static int full_root(list_t * list, board_t * board, int alpha, int beta, int de
    ASSERT(SearchBest[ThreadId]->value==best_value);
 
    if (UseTrans && best_value[SearchCurrent[ThreadId]->multipv] > old_alpha && best_value[SearchCurrent[ThreadId]->multipv] < beta) {
-      pv_fill(SearchBest[ThreadId][SearchCurrent[ThreadId]->multipv].pv,board);
+      pv_fill(SearchBest[ThreadId][SearchCurrent[ThreadId]->multipv].pv,board,ThreadId);
    }
 
    return best_value[SearchCurrent[ThreadId]->multipv];
@@ -437,6 +601,14 @@ static int full_search(board_t * board, int alpha, int beta, int depth, int heig
 	   return full_quiescence(board,alpha,beta,0,height,pv,ThreadId);
    }
 
+   // checks come before this node is counted, so that "go nodes" stops on the exact count
+
+   if (SearchInfo[ThreadId]->check_nb <= 0 || SearchInfo[ThreadId]->poll) search_check(ThreadId);
+
+   if (SearchInfo[ThreadId]->split != NULL) split_check(ThreadId);
+
+   if (SearchInfo[ThreadId]->abort) return ValueNone; // unwinding, the value is not used
+
    // init
 
    SearchCurrent[ThreadId]->node_nb++;
@@ -445,17 +617,19 @@ static int full_search(board_t * board, int alpha, int beta, int depth, int heig
 
    if (height > SearchCurrent[ThreadId]->max_depth) SearchCurrent[ThreadId]->max_depth = height;
 
-   if (SearchInfo[ThreadId]->check_nb <= 0) {
-      SearchInfo[ThreadId]->check_nb += SearchInfo[ThreadId]->check_inc;
-      search_check(ThreadId);
-   }
-
    // draw?
 
    if (board_is_repetition(board)) return ValueDraw;
 
    if (recog_draw(board,ThreadId)) return ValueDraw;
 
+   // a draw is at hand if the side to move can repeat a position
+
+   if (UseCycle && alpha < ValueDraw && board_has_cycle(board)) {
+      alpha = ValueDraw;
+      if (alpha >= beta) return alpha;
+   }
+
    // mate-distance pruning
 
    if (UseDistancePruning) {
@@ -486,7 +660,7 @@ static int full_search(board_t * board, int alpha, int beta, int depth, int heig
 
    if (UseTrans && depth >= TransDepth) {
 
-      	if (trans_retrieve(Trans,&found_entry,board->key,&trans_move,&trans_depth,&trans_flags,&trans_value)) {
+      	if (trans_retrieve(Trans,&found_entry,board->key,&trans_move,&trans_depth,&trans_flags,&trans_value,ThreadId)) {
           
 		  	if (node_type != NodePV /*|| ThreadId > 0*/) {
 
@@ -510,6 +684,7 @@ static int full_search(board_t * board, int alpha, int beta, int depth, int heig
 
 				  	 			if ((TRANS_IS_LOWER(trans_flags) && trans_value >= beta + earlyTransPruningMargin*depth_margin)
 									|| (TRANS_IS_UPPER(trans_flags) && trans_value <= alpha - earlyTransPruningMargin*depth_margin)) {
+									trans_cutoff(Trans,ThreadId);
 									return trans_value;
 				  				} 
 				  			} else if (trans_depth+earlyTransPruningDepth+1 >= depth){
@@ -525,6 +700,8 @@ static int full_search(board_t * board, int alpha, int beta, int depth, int heig
 					  				SearchCurrent[ThreadId]->trans_reduction = true;
 				       				value = full_search(board,alpha,beta,depth-earlyTransPruningDepth,height,new_pv,node_type,false,ThreadId); 
 				       				SearchCurrent[ThreadId]->trans_reduction = false;
+
+				       				if (SearchInfo[ThreadId]->abort) return ValueNone;
 				                    
 				                    // if the search returns the expected value, we return. if not, go on to full depth search
 				                    if (node_type == NodeCut && value >= beta)
@@ -546,6 +723,7 @@ static int full_search(board_t * board, int alpha, int beta, int depth, int heig
 				   		if ((UseExact && TRANS_IS_EXACT(trans_flags))
 							|| (TRANS_IS_LOWER(trans_flags) && trans_value >= beta)
 							|| (TRANS_IS_UPPER(trans_flags) && trans_value <= alpha)) {
+							trans_cutoff(Trans,ThreadId);
 							return trans_value;
 				   } 
 				}
@@ -614,6 +792,8 @@ static int full_search(board_t * board, int alpha, int beta, int depth, int heig
          
 		 move_undo_null(board,undo);
 
+         if (SearchInfo[ThreadId]->abort) return ValueNone;
+
          // pruning
 
          if (value >= beta) {
@@ -649,6 +829,8 @@ static int full_search(board_t * board, int alpha, int beta, int depth, int heig
       value = full_search(board,alpha,beta,new_depth,height,new_pv,node_type,false,ThreadId);
       if (value <= alpha) value = full_search(board,-ValueInf,beta,new_depth,height,new_pv,node_type,false,ThreadId);
 
+      if (SearchInfo[ThreadId]->abort) return ValueNone;
+
       trans_move = new_pv[0];
    }
 
@@ -726,6 +908,8 @@ static int full_search(board_t * board, int alpha, int beta, int depth, int heig
 
 	  // recursive search
 
+	  prefetch_move(board,move,ThreadId);
+
 	  move_do(board,move,undo);
 	  
 	  SearchCurrent[ThreadId]->last_move = move;
@@ -762,6 +946,8 @@ static int full_search(board_t * board, int alpha, int beta, int depth, int heig
 
       move_undo(board,move,undo);
 
+      if (SearchInfo[ThreadId]->abort) return ValueNone;
+
       played[played_nb++] = move;
 	  
       if (value > best_value) {
@@ -777,6 +963,20 @@ static int full_search(board_t * board, int alpha, int beta, int depth, int heig
       }
 
       if (node_type == NodeCut) node_type = NodeAll;
+
+      // parallel search of the remaining moves (the eldest brother is done)
+
+      if (UseSplit && depth >= SplitDepth && IdleNb > 0 && SplitNb[ThreadId] < SplitMax) {
+
+         if (full_split(board,sort,attack,&alpha,beta,depth,height,node_type,cut_node,extended,in_check,single_reply,
+                        &best_value,&best_move,pv,played,&played_nb,&good_cap,&quiet_move_count,ThreadId)) {
+
+            if (SearchInfo[ThreadId]->abort) return ValueNone;
+
+            if (best_value >= beta) goto cut;
+            break;
+         }
+      }
    }
 
    // ALL node
@@ -831,7 +1031,7 @@ cut:
       if (best_value < beta) trans_flags |= TransUpper;
       trans_value = value_to_trans(best_value,height);
 
-      trans_store(Trans,board->key,trans_move,trans_depth,trans_flags,trans_value);
+      trans_store(Trans,board->key,trans_move,trans_depth,trans_flags,trans_value,ThreadId);
 
    }
 
@@ -864,6 +1064,14 @@ static int full_quiescence(board_t * board, int alpha, int beta, int depth, int
    ASSERT(board_is_legal(board));
    ASSERT(depth<=0);
 
+   // checks first, see full_search()
+
+   if (SearchInfo[ThreadId]->check_nb <= 0 || SearchInfo[ThreadId]->poll) search_check(ThreadId);
+
+   if (SearchInfo[ThreadId]->split != NULL) split_check(ThreadId);
+
+   if (SearchInfo[ThreadId]->abort) return ValueNone; // unwinding, the value is not used
+
    // init
 
    SearchCurrent[ThreadId]->node_nb++;
@@ -872,17 +1080,19 @@ static int full_quiescence(board_t * board, int alpha, int beta, int depth, int
 
    if (height > SearchCurrent[ThreadId]->max_depth) SearchCurrent[ThreadId]->max_depth = height;
 
-   if (SearchInfo[ThreadId]->check_nb <= 0) {
-      SearchInfo[ThreadId]->check_nb += SearchInfo[ThreadId]->check_inc;
-      search_check(ThreadId);
-   }
-
    // draw?
 
    if (board_is_repetition(board)) return ValueDraw;
 
    if (recog_draw(board,ThreadId)) return ValueDraw;
 
+   // a draw is at hand if the side to move can repeat a position
+
+   if (UseCycle && alpha < ValueDraw && board_has_cycle(board)) {
+      alpha = ValueDraw;
+      if (alpha >= beta) return alpha;
+   }
+
    // mate-distance pruning
 
    if (UseDistancePruning) {
@@ -914,13 +1124,14 @@ static int full_quiescence(board_t * board, int alpha, int beta, int depth, int
    
    if (UseTrans) { 
 
-      if (trans_retrieve(Trans,&found_entry,board->key,&trans_move,&trans_depth,&trans_flags,&trans_value)) {
+      if (trans_retrieve(Trans,&found_entry,board->key,&trans_move,&trans_depth,&trans_flags,&trans_value,ThreadId)) {
 
 		 trans_value = value_from_trans(trans_value,height);
 
 	 	 if ((UseExact && trans_value != ValueNone && TRANS_IS_EXACT(trans_flags)) 
 		 	 || (TRANS_IS_LOWER(trans_flags) && trans_value >= beta)
 			 || (TRANS_IS_UPPER(trans_flags) && trans_value <= alpha)) {
+			 trans_cutoff(Trans,ThreadId);
 			 return trans_value;
 		 } 
 	  }
@@ -1021,10 +1232,14 @@ static int full_quiescence(board_t * board, int alpha, int beta, int depth, int
          }
       }
 
+      prefetch_move(board,move,ThreadId);
+
       move_do(board,move,undo);
       value = -full_quiescence(board,-beta,-alpha,depth-1,height+1,new_pv,ThreadId);
       move_undo(board,move,undo);
 
+      if (SearchInfo[ThreadId]->abort) return ValueNone;
+
       if (value > best_value) {
          best_value = value;
          pv_cat(pv,new_pv,move);
@@ -1056,7 +1271,7 @@ cut:
       if (best_value < beta) trans_flags |= TransUpper;
       trans_value = value_to_trans(best_value,height);
 
-      trans_store(Trans,board->key,trans_move,trans_depth,trans_flags,trans_value);
+      trans_store(Trans,board->key,trans_move,trans_depth,trans_flags,trans_value,ThreadId);
 
    }
 
@@ -1065,6 +1280,394 @@ cut:
    return best_value;
 }
 
+// full_split()
+
+static bool full_split(board_t * board, const sort_t * sort, const attack_t * attack, int * alpha, int beta, int depth, int height, int node_type, bool cut_node, bool extended, bool in_check, bool single_reply, int * best_value, int * best_move, mv_t pv[], mv_t played[], int * played_nb, bool * good_cap, int * quiet_move_count, int ThreadId) {
+
+   split_t * sp;
+   int i;
+
+   ASSERT(board==SearchCurrent[ThreadId]->board);
+   ASSERT(sort!=NULL);
+   ASSERT(attack!=NULL);
+   ASSERT(alpha!=NULL);
+   ASSERT(range_is_ok(*alpha,beta));
+   ASSERT(*best_value!=ValueNone);
+   ASSERT(*played_nb>0);
+
+   // book a split point and attach the idle threads
+
+   LOCK(SplitLock);
+
+   if (IdleNb == 0 || SplitNb[ThreadId] >= SplitMax) {
+      UNLOCK(SplitLock);
+      return false;
+   }
+
+   sp = &SplitPoint[ThreadId][SplitNb[ThreadId]++];
+
+   sp->parent = SearchInfo[ThreadId]->split;
+   sp->master = ThreadId;
+   sp->slave_nb = 0;
+   sp->stop = false;
+
+   board_fork(sp->board,board,sp->history); // the master keeps playing on its own history
+   *sp->attack = *attack;
+   *sp->sort = *sort;
+   sp->sort->board = sp->board;
+   sp->sort->attack = sp->attack;
+   sp->sort_end = false;
+
+   sp->beta = beta;
+   sp->depth = depth;
+   sp->height = height;
+   sp->node_type = node_type;
+   sp->cut_node = cut_node;
+   sp->extended = extended;
+   sp->in_check = in_check;
+   sp->single_reply = single_reply;
+   sp->trans_reduction = SearchCurrent[ThreadId]->trans_reduction;
+
+   sp->alpha = *alpha;
+   sp->best_value = *best_value;
+   sp->best_move = *best_move;
+   sp->played_nb = *played_nb;
+   sp->quiet_move_count = *quiet_move_count;
+   sp->good_cap = *good_cap;
+   for (i = 0; i < *played_nb; i++) sp->played[i] = played[i];
+   pv_copy(sp->pv,pv);
+
+   for (i = 0; i < NumberThreads; i++) {
+      if (i != ThreadId && SearchInfo[i]->idle) {
+         SearchInfo[i]->idle = false;
+         IdleNb--;
+         sp->slave_nb++;
+         SearchInfo[i]->work = sp;
+      }
+   }
+
+   COND_SIGNAL(SplitWake);
+   UNLOCK(SplitLock);
+
+   // search the remaining moves along with the slaves
+
+   split_search(sp,ThreadId);
+
+   if (SearchInfo[ThreadId]->abort) return true; // unwinding further up
+
+   // results
+
+   *alpha = sp->alpha;
+   *best_value = sp->best_value;
+   *best_move = sp->best_move;
+   *quiet_move_count = sp->quiet_move_count;
+   *good_cap = sp->good_cap;
+   pv_copy(pv,sp->pv);
+
+   *played_nb = sp->played_nb;
+   for (i = 0; i < sp->played_nb; i++) played[i] = sp->played[i];
+
+   for (i = 0; i < *played_nb-1; i++) { // the best move goes last, as in the sequential loop
+      if (played[i] == sp->best_move) {
+         played[i] = played[*played_nb-1];
+         played[*played_nb-1] = sp->best_move;
+         break;
+      }
+   }
+
+   // a result is meaningless if an enclosing split point was cut off meanwhile
+
+   if (SearchInfo[ThreadId]->split != NULL) split_check(ThreadId);
+
+   return true;
+}
+
+// split_search()
+
+static void split_search(split_t * sp, int ThreadId) {
+
+   split_t * old_split;
+   board_t * board;
+   bool abort;
+
+   ASSERT(sp!=NULL);
+
+   board = SearchCurrent[ThreadId]->board;
+
+   if (ThreadId != sp->master) {
+      LOCK(sp->lock); // sort_next() plays en-passant captures on the split board
+      board_fork(board,sp->board,SearchCurrent[ThreadId]->history);
+      UNLOCK(sp->lock);
+      SearchCurrent[ThreadId]->trans_reduction = sp->trans_reduction;
+      SearchCurrent[ThreadId]->do_nullmove = true;
+   }
+
+   old_split = SearchInfo[ThreadId]->split;
+   SearchInfo[ThreadId]->split = sp;
+
+   split_loop(sp,board,ThreadId);
+
+   abort = SearchInfo[ThreadId]->abort;
+   split_leave(sp,old_split,abort,ThreadId);
+
+   // an abort unwinds to the split point that was cut off (slaves leave
+   // theirs anyway, see search_full_idle()) or out of the search
+
+   if (abort && ThreadId == sp->master && SearchInfo[ThreadId]->cut == sp) {
+
+      // this split point failed high: resume the sequential search here
+
+      ASSERT(board->key==sp->board->key);
+
+      SearchInfo[ThreadId]->abort = false;
+      SearchCurrent[ThreadId]->trans_reduction = sp->trans_reduction;
+      SearchCurrent[ThreadId]->do_nullmove = true;
+   }
+}
+
+// split_loop()
+
+static void split_loop(split_t * sp, board_t * board, int ThreadId) {
+
+   int move, value;
+   int alpha, beta, depth, height, node_type;
+   int new_depth, reduction;
+   bool reduced, cap_extended;
+   undo_t undo[1];
+   mv_t new_pv[HeightMax];
+
+   ASSERT(sp!=NULL);
+   ASSERT(board_is_ok(board));
+
+   beta = sp->beta;
+   depth = sp->depth;
+   height = sp->height;
+   node_type = sp->node_type;
+
+   // same move loop as full_search(), shared through the split point
+
+   while (!sp->stop) {
+
+      LOCK(sp->lock);
+
+      if (sp->stop || sp->sort_end) {
+         UNLOCK(sp->lock);
+         break;
+      }
+
+      move = sort_next(sp->sort,sp->master);
+
+      if (move == MoveNone) { // sort_next() must not be called again
+         sp->sort_end = true;
+         UNLOCK(sp->lock);
+         break;
+      }
+
+      // extensions
+
+      new_depth = full_new_depth(depth,move,board,sp->single_reply,node_type==NodePV,height,sp->extended,&cap_extended,ThreadId);
+
+      // history pruning
+
+      value = sp->sort->value; // history score
+      if (!sp->in_check && depth <= 6 && node_type != NodePV
+       && new_depth < depth && value < 2 * HistoryValue / (depth + depth % 2)
+       && sp->played_nb >= 1+depth && !move_is_dangerous(move,board)) {
+         UNLOCK(sp->lock);
+         continue;
+      }
+
+      // quiet move count based pruning
+
+      if (node_type != NodePV && depth <= 5) {
+
+         if (!sp->in_check && new_depth < depth && !move_is_tactical(move,board) && !move_is_dangerous(move,board)) {
+
+            if (sp->quiet_move_count >= MoveCountLimit[depth] + NumberThreads-1-sp->master) {
+               UNLOCK(sp->lock);
+               continue;
+            }
+            sp->quiet_move_count++;
+         }
+      }
+
+      // Late Move Reductions
+
+      reduced = false;
+      reduction = 0;
+
+      if (UseHistory) {
+         if (!sp->in_check && new_depth < depth && sp->played_nb >= HistoryMoveNb
+          && depth >= HistoryDepth && !move_is_dangerous(move,board)) {
+
+            if (sp->good_cap && !move_is_tactical(move,board)) sp->good_cap = false;
+
+            if (!sp->good_cap) {
+               reduction = (node_type == NodePV ? QuietPVMoveReduction[depth<64 ? depth: 63][sp->played_nb<64? sp->played_nb: 63]:
+                            QuietMoveReduction[depth<64 ? depth: 63][sp->played_nb<64? sp->played_nb: 63]);
+
+               if (move_is_tactical(move,board)) reduction = reduction / 2; // bad captures
+               else if (sp->cut_node && new_depth - reduction > 1) reduction++;
+
+               if (reduction > 0) reduced = true;
+            }
+         }
+      }
+
+      sp->played[sp->played_nb++] = move;
+      alpha = sp->alpha;
+
+      UNLOCK(sp->lock);
+
+      // recursive search
+
+      prefetch_move(board,move,ThreadId);
+
+      move_do(board,move,undo);
+
+      SearchCurrent[ThreadId]->last_move = move;
+
+      if (node_type != NodePV) {
+
+         value = -full_search(board,-beta,-alpha,new_depth-reduction,height+1,new_pv,NODE_OPP(node_type),cap_extended,ThreadId);
+
+         if (reduced && value >= beta) {
+            value = -full_search(board,-beta,-alpha,new_depth,height+1,new_pv,NODE_OPP(node_type),cap_extended,ThreadId);
+         }
+
+      } else {
+
+         value = -full_search(board,-alpha-1,-alpha,new_depth-reduction,height+1,new_pv,NodeCut,cap_extended,ThreadId);
+
+         if (value > alpha && reduced) {
+            value = -full_search(board,-beta,-alpha,new_depth-reduction,height+1,new_pv,NodePV,cap_extended,ThreadId);
+            if (value >= beta) {
+               value = -full_search(board,-beta,-alpha,new_depth,height+1,new_pv,NodePV,cap_extended,ThreadId);
+            }
+         } else if (value > alpha) {
+            value = -full_search(board,-beta,-alpha,new_depth,height+1,new_pv,NodePV,cap_extended,ThreadId);
+         }
+      }
+
+      move_undo(board,move,undo);
+
+      if (SearchInfo[ThreadId]->abort) break;
+
+      // update the split point
+
+      LOCK(sp->lock);
+
+      if (value > sp->best_value) {
+         sp->best_value = value;
+         pv_cat(sp->pv,new_pv,move);
+         if (value > sp->alpha) {
+            sp->alpha = value;
+            sp->best_move = move;
+            if (value >= beta) sp->stop = true; // the slaves abort
+         }
+      }
+
+      UNLOCK(sp->lock);
+   }
+}
+
+// split_leave()
+
+static void split_leave(split_t * sp, split_t * old_split, bool abort, int ThreadId) {
+
+   ASSERT(sp!=NULL);
+
+   if (ThreadId == sp->master) {
+
+      // the split point outlives its slaves
+
+      LOCK(sp->lock);
+      if (abort) sp->stop = true;
+      while (sp->slave_nb > 0) COND_WAIT(sp->done,sp->lock);
+      UNLOCK(sp->lock);
+
+      ASSERT(sp==&SplitPoint[ThreadId][SplitNb[ThreadId]-1]);
+      SplitNb[ThreadId]--;
+
+   } else {
+
+      LOCK(sp->lock);
+      sp->slave_nb--;
+      if (sp->slave_nb == 0) COND_SIGNAL(sp->done);
+      UNLOCK(sp->lock);
+   }
+
+   SearchInfo[ThreadId]->split = old_split;
+}
+
+// split_check()
+
+static void split_check(int ThreadId) {
+
+   split_t * sp, * cut;
+
+   if (SearchInfo[ThreadId]->abort) return; // already unwinding, maybe out of the search
+
+   // unwind to the outermost split point that was cut off
+
+   cut = NULL;
+
+   for (sp = SearchInfo[ThreadId]->split; sp != NULL; sp = sp->parent) {
+      if (sp->stop) cut = sp;
+   }
+
+   if (cut != NULL) {
+      SearchInfo[ThreadId]->cut = cut;
+      SearchInfo[ThreadId]->abort = true;
+   }
+}
+
+// search_full_idle()
+
+void search_full_idle(int ThreadId) {
+
+   split_t * sp;
+
+   ASSERT(ThreadId>0&&ThreadId<NumberThreads);
+
+   LOCK(SplitLock);
+   SearchInfo[ThreadId]->work = NULL;
+   SearchInfo[ThreadId]->idle = true;
+   IdleNb++;
+
+   // sleep until a split point attaches us or the search is over
+
+   while (true) {
+
+      while (SearchInfo[ThreadId]->work == NULL && !SearchInfo[ThreadId]->stop) {
+         COND_WAIT(SplitWake,SplitLock);
+      }
+
+      sp = SearchInfo[ThreadId]->work;
+
+      if (sp == NULL) { // stopped, leave the pool
+         SearchInfo[ThreadId]->idle = false;
+         IdleNb--;
+         break;
+      }
+
+      UNLOCK(SplitLock);
+
+      split_search(sp,ThreadId);
+
+      SearchInfo[ThreadId]->abort = false; // a slave only unwinds to here
+
+      LOCK(SplitLock);
+      SearchInfo[ThreadId]->work = NULL;
+      SearchInfo[ThreadId]->idle = true;
+      IdleNb++;
+   }
+
+   UNLOCK(SplitLock);
+
+   ASSERT(SearchInfo[ThreadId]->work==NULL);
+}
+
 // full_new_depth()
 
 static int full_new_depth(int depth, int move, board_t * board, bool single_reply, bool in_pv, int height, bool extended, bool * cap_extended, int ThreadId) {
@@ -1146,7 +1749,7 @@ static bool do_ver(const board_t * board) {
 
 // pv_fill()
 
-static void pv_fill(const mv_t pv[], board_t * board) {
+static void pv_fill(const mv_t pv[], board_t * board, int ThreadId) {
 
    int move;
    int trans_move, trans_depth;
@@ -1162,13 +1765,13 @@ static void pv_fill(const mv_t pv[], board_t * board) {
    if (move != MoveNone && move != MoveNull) {
 
       move_do(board,move,undo);
-      pv_fill(pv+1,board);
+      pv_fill(pv+1,board,ThreadId);
       move_undo(board,move,undo);
 
       trans_move = move;
       trans_depth = -127; // HACK
       
-      trans_store(Trans,board->key,trans_move,trans_depth,TransUnknown,-ValueInf);
+      trans_store(Trans,board->key,trans_move,trans_depth,TransUnknown,-ValueInf,ThreadId);
    }
 }
 
@@ -1323,5 +1926,23 @@ static bool pawn_is_endgame(int move, const board_t * board) {
    
 }
 
+// prefetch_move()
+
+static void prefetch_move(const board_t * board, int move, int ThreadId) {
+
+   uint64 key, pawn_key, material_key;
+
+   ASSERT(board!=NULL);
+   ASSERT(move_is_ok(move));
+
+   // start the child's cache misses before move_do() rather than at the probe
+
+   move_do_key(board,move,&key,&pawn_key,&material_key);
+
+   if (UseTrans) trans_prefetch(Trans,key);
+   if (pawn_key != board->pawn_key) pawn_prefetch(pawn_key,ThreadId);
+   if (material_key != board->material_key) material_prefetch(material_key,ThreadId);
+}
+
 // end of search_full.cpp
 
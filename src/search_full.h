@@ -11,9 +11,17 @@
 
 // functions
 
+extern void search_full_split_init ();
+
+extern void search_full_alloc (int ThreadId);
+extern void search_full_free  (int ThreadId);
+
 extern void search_full_init (list_t * list, board_t * board, int ThreadId);
 extern int  search_full_root (list_t * list, board_t * board, int a, int b, int depth, int search_type, int ThreadId);
 
+extern void search_full_idle (int ThreadId);
+extern void search_full_wake ();
+
 //extern bool egbb_is_loaded;
 
 #endif // !defined SEARCH_FULL_H
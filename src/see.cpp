@@ -4,6 +4,7 @@
 // includes
 
 #include "attack.h"
+#include "bitboard.h"
 #include "board.h"
 #include "colour.h"
 #include "move.h"
@@ -247,38 +248,22 @@ static void alist_build(alist_t * alist, const board_t * board, int to, int colo
 
    const sq_t * ptr;
    int from;
-   int piece;
-   int delta;
    int inc;
-   int sq;
    int pawn;
+   uint64 attack;
 
    ASSERT(alist!=NULL);
    ASSERT(board!=NULL);
    ASSERT(SQUARE_IS_OK(to));
    ASSERT(COLOUR_IS_OK(colour));
 
-   // piece attacks
-
-   for (ptr = &board->piece[colour][0]; (from=*ptr) != SquareNone; ptr++) {
-
-      piece = board->square[from];
-      delta = to - from;
-
-      if (PSEUDO_ATTACK(piece,delta)) {
+   attack = attackers(board,to,colour);
+   if (attack == 0) return;
 
-         inc = DELTA_INC_ALL(delta);
-         ASSERT(inc!=IncNone);
+   // piece attacks, in piece-list order for equal values
 
-         sq = from;
-         do {
-            sq += inc;
-            if (sq == to) { // attack
-               alist_add(alist,from,board);
-               break;
-            }
-         } while (board->square[sq] == Empty);
-      }
+   for (ptr = &board->piece[colour][0]; (from=*ptr) != SquareNone; ptr++) {
+      if ((attack & SQUARE_BIT(from)) != 0) alist_add(alist,from,board);
    }
 
    // pawn attacks
@@ -16,14 +16,12 @@
 #include "search.h"
 #include "see.h"
 #include "sort.h"
+#include "thread.h"
 #include "util.h"
 #include "value.h"
 
 // constants
 
-static const int KillerNb = 2;
-
-static const int HistorySize = 12 * 64 /** 64*/;
 static const int HistoryMax = 2048;
 
 static const int TransScore   = +32766;
@@ -78,13 +76,6 @@ static int PosCaptureQS;
 
 static int Code[CODE_SIZE];
 
-static uint16 Killer[MaxThreads][HeightMax][KillerNb];
-static uint16 Refutation[MaxThreads][12][64][64];
-
-static sint16 History[MaxThreads][HistorySize];
-static uint16 HistHit[MaxThreads][HistorySize];
-static uint16 HistTot[MaxThreads][HistorySize];
-
 // prototypes
 
 static void note_captures     (list_t * list, const board_t * board);
@@ -118,25 +109,25 @@ void sort_init(int ThreadId) {
    // killer
 
    for (height = 0; height < HeightMax; height++) {
-      for (i = 0; i < KillerNb; i++) Killer[ThreadId][height][i] = MoveNone;
+      for (i = 0; i < KillerNb; i++) Thread[ThreadId]->sort->killer[height][i] = MoveNone;
    }
    
    // refutation table
    
    for (i = 0; i < 12; i++) {
       for (j = 0; j < 64; j++){
-      	for (k = 0; k < 64; k++)Refutation[ThreadId][i][j][k] = MoveNone;
+      	for (k = 0; k < 64; k++)Thread[ThreadId]->sort->refutation[i][j][k] = MoveNone;
       } 
    }
 
    // history
 
-   for (i = 0; i < HistorySize; i++) History[ThreadId][i] = 0;
+   for (i = 0; i < HistorySize; i++) Thread[ThreadId]->sort->history[i] = 0;
 
    //if (first_time){
 	   for (i = 0; i < HistorySize; i++) {
-		  HistHit[ThreadId][i] = 1;
-		  HistTot[ThreadId][i] = 1;
+		  Thread[ThreadId]->sort->hist_hit[i] = 1;
+		  Thread[ThreadId]->sort->hist_tot[i] = 1;
 	   }
 	//   first_time = false;
    //}
@@ -209,9 +200,9 @@ void sort_init(sort_t * sort, board_t * board, const attack_t * attack, int dept
    sort->capture_nb = 0;
 
    sort->trans_killer = trans_killer;
-   sort->killer_1 = Killer[ThreadId][sort->height][0];
-   sort->killer_2 = Killer[ThreadId][sort->height][1];
-   sort->refutation_move = Refutation[ThreadId][piece][from_64][to_64];
+   sort->killer_1 = Thread[ThreadId]->sort->killer[sort->height][0];
+   sort->killer_2 = Thread[ThreadId]->sort->killer[sort->height][1];
+   sort->refutation_move = (piece >= 0) ? Thread[ThreadId]->sort->refutation[piece][from_64][to_64] : MoveNone;
    
    if (ATTACK_IN_CHECK(sort->attack)) {
 
@@ -515,23 +506,23 @@ void good_move(int move, const board_t * board, int depth, int height, int Threa
 
    // killer
 
-   if (Killer[ThreadId][height][0] != move) {
-      Killer[ThreadId][height][1] = Killer[ThreadId][height][0];
-      Killer[ThreadId][height][0] = move;
+   if (Thread[ThreadId]->sort->killer[height][0] != move) {
+      Thread[ThreadId]->sort->killer[height][1] = Thread[ThreadId]->sort->killer[height][0];
+      Thread[ThreadId]->sort->killer[height][0] = move;
    }
 
-   ASSERT(Killer[ThreadId][height][0]==move);
-   ASSERT(Killer[ThreadId][height][1]!=move);
+   ASSERT(Thread[ThreadId]->sort->killer[height][0]==move);
+   ASSERT(Thread[ThreadId]->sort->killer[height][1]!=move);
    
    // history
 
    index = history_index(move,board);
 
-   History[ThreadId][index] += HISTORY_INC(depth);
+   Thread[ThreadId]->sort->history[index] += HISTORY_INC(depth);
 
-   if (History[ThreadId][index] >= HistoryMax) {
+   if (Thread[ThreadId]->sort->history[index] >= HistoryMax) {
       for (i = 0; i < HistorySize; i++) {
-         History[ThreadId][i] = (History[ThreadId][i] + 1) / 2;
+         Thread[ThreadId]->sort->history[i] = (Thread[ThreadId]->sort->history[i] + 1) / 2;
       }
    } 
 }
@@ -554,11 +545,11 @@ void bad_move(int move, const board_t * board, int depth, int height, int Thread
 
    index = history_index(move,board);
 
-   History[ThreadId][index] -= depth;
+   Thread[ThreadId]->sort->history[index] -= depth;
 
-   if (History[ThreadId][index] >= HistoryMax) {
+   if (Thread[ThreadId]->sort->history[index] >= HistoryMax) {
       for (i = 0; i < HistorySize; i++) {
-         History[ThreadId][i] = (History[ThreadId][i] + 1) / 2;
+         Thread[ThreadId]->sort->history[i] = (Thread[ThreadId]->sort->history[i] + 1) / 2;
       }
    } 
 }
@@ -583,9 +574,11 @@ void refutation_update(int best_move, int last_move, const board_t * board, int
 
    //if (move_is_tactical(move,board)) return;
 
+   if (piece < 0) return; // stale last_move, would write outside the table
+
    // refutation
 
-   Refutation[ThreadId][piece][from_64][to_64] = best_move;
+   Thread[ThreadId]->sort->refutation[piece][from_64][to_64] = best_move;
    
 }
    
@@ -605,16 +598,16 @@ void history_good(int move, const board_t * board, int ThreadId) {
 
    index = history_index(move,board);
 
-   HistHit[ThreadId][index]++;
-   HistTot[ThreadId][index]++;
+   Thread[ThreadId]->sort->hist_hit[index]++;
+   Thread[ThreadId]->sort->hist_tot[index]++;
    
-   if (HistTot[ThreadId][index] >= HistoryMax) {
-      HistHit[ThreadId][index] = (HistHit[ThreadId][index] + 1) / 2;
-      HistTot[ThreadId][index] = (HistTot[ThreadId][index] + 1) / 2;
+   if (Thread[ThreadId]->sort->hist_tot[index] >= HistoryMax) {
+      Thread[ThreadId]->sort->hist_hit[index] = (Thread[ThreadId]->sort->hist_hit[index] + 1) / 2;
+      Thread[ThreadId]->sort->hist_tot[index] = (Thread[ThreadId]->sort->hist_tot[index] + 1) / 2;
    }
 
-   ASSERT(HistHit[ThreadId][index]<=HistTot[ThreadId][index]);
-   ASSERT(HistTot[ThreadId][index]<HistoryMax);
+   ASSERT(Thread[ThreadId]->sort->hist_hit[index]<=Thread[ThreadId]->sort->hist_tot[index]);
+   ASSERT(Thread[ThreadId]->sort->hist_tot[index]<HistoryMax);
 }
 
 // history_bad()
@@ -632,15 +625,15 @@ void history_bad(int move, const board_t * board, int ThreadId) {
 
    index = history_index(move,board);
 
-   HistTot[ThreadId][index]++;
+   Thread[ThreadId]->sort->hist_tot[index]++;
    
-   if (HistTot[ThreadId][index] >= HistoryMax) {
-      HistHit[ThreadId][index] = (HistHit[ThreadId][index] + 1) / 2;
-      HistTot[ThreadId][index] = (HistTot[ThreadId][index] + 1) / 2;
+   if (Thread[ThreadId]->sort->hist_tot[index] >= HistoryMax) {
+      Thread[ThreadId]->sort->hist_hit[index] = (Thread[ThreadId]->sort->hist_hit[index] + 1) / 2;
+      Thread[ThreadId]->sort->hist_tot[index] = (Thread[ThreadId]->sort->hist_tot[index] + 1) / 2;
    }
 
-   ASSERT(HistHit[ThreadId][index]<=HistTot[ThreadId][index]);
-   ASSERT(HistTot[ThreadId][index]<HistoryMax);
+   ASSERT(Thread[ThreadId]->sort->hist_hit[index]<=Thread[ThreadId]->sort->hist_tot[index]);
+   ASSERT(Thread[ThreadId]->sort->hist_tot[index]<HistoryMax);
 }
 
 void history_reset(int move, const board_t * board, int ThreadId) {
@@ -654,11 +647,11 @@ void history_reset(int move, const board_t * board, int ThreadId) {
 
    index = history_index(move,board);
 
-   HistHit[ThreadId][index] = 1; //HistHit[ThreadId][index]/3 + 1;
-   HistTot[ThreadId][index] = 1; //HistHit[ThreadId][index]/2 + 1;
+   Thread[ThreadId]->sort->hist_hit[index] = 1; //Thread[ThreadId]->sort->hist_hit[index]/3 + 1;
+   Thread[ThreadId]->sort->hist_tot[index] = 1; //Thread[ThreadId]->sort->hist_hit[index]/2 + 1;
 
-   ASSERT(HistHit[ThreadId][index]<=HistTot[ThreadId][index]);
-   ASSERT(HistTot[ThreadId][index]<HistoryMax);
+   ASSERT(Thread[ThreadId]->sort->hist_hit[index]<=Thread[ThreadId]->sort->hist_tot[index]);
+   ASSERT(Thread[ThreadId]->sort->hist_tot[index]<HistoryMax);
 }
 
 // note_moves()
@@ -779,9 +772,9 @@ static int move_value(int move, const board_t * board, int height, int trans_kil
       value = TransScore;
    } else if (move_is_tactical(move,board)) { // capture or promote
       value = capture_value(move,board);
-   } else if (move == Killer[ThreadId][height][0]) { // killer 1
+   } else if (move == Thread[ThreadId]->sort->killer[height][0]) { // killer 1
       value = KillerScore;
-   } else if (move == Killer[ThreadId][height][1]) { // killer 2
+   } else if (move == Thread[ThreadId]->sort->killer[height][1]) { // killer 2
       value = KillerScore - 2;
    } else { // quiet move
       value = quiet_move_value(move,board,ThreadId);
@@ -828,7 +821,7 @@ static int quiet_move_value(int move, const board_t * board, int ThreadId) {
 
    index = history_index(move,board);
 
-   value = HistoryScore + History[ThreadId][index];
+   value = HistoryScore + Thread[ThreadId]->sort->history[index];
    ASSERT(value>=HistoryScore&&value<=KillerScore-4);
 
    return value;
@@ -863,10 +856,10 @@ static int history_prob(int move, const board_t * board, int ThreadId) {
 
    index = history_index(move,board);
 
-   ASSERT(HistHit[ThreadId][index]<=HistTot[ThreadId][index]);
-   ASSERT(HistTot[ThreadId][index]<HistoryMax);
+   ASSERT(Thread[ThreadId]->sort->hist_hit[index]<=Thread[ThreadId]->sort->hist_tot[index]);
+   ASSERT(Thread[ThreadId]->sort->hist_tot[index]<HistoryMax);
 
-   value = (HistHit[ThreadId][index] * 16384) / HistTot[ThreadId][index];
+   value = (Thread[ThreadId]->sort->hist_hit[index] * 16384) / Thread[ThreadId]->sort->hist_tot[index];
    
    ASSERT(value>=0&&value<=16384);
 
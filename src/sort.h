@@ -9,10 +9,25 @@
 #include "attack.h"
 #include "board.h"
 #include "list.h"
+#include "search.h"
 #include "util.h"
 
+// constants
+
+const int KillerNb = 2;
+
+const int HistorySize = 12 * 64 /** 64*/;
+
 // types
 
+struct sort_data_t { // per-thread move-ordering tables
+   uint16 killer[HeightMax][KillerNb];
+   uint16 refutation[12][64][64];
+   sint16 history[HistorySize];
+   uint16 hist_hit[HistorySize];
+   uint16 hist_tot[HistorySize];
+};
+
 struct sort_t {
    int depth;
    int height;
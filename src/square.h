@@ -83,7 +83,7 @@ const int Light = 1;
 
 // types
 
-typedef int sq_t;
+typedef uint8 sq_t;
 
 // "constants"
 
@@ -0,0 +1,78 @@
+
+// thread.cpp
+
+// includes
+
+#include <cstring>
+
+#include "eval.h"
+#include "material.h"
+#include "pawn.h"
+#include "search.h"
+#include "search_full.h"
+#include "thread.h"
+#include "util.h"
+
+// constants
+
+static const int ThreadAlign = 64; // no cache line is shared between two threads
+
+// variables
+
+thread_t * Thread[MaxThreads];
+
+// functions
+
+// thread_alloc()
+
+void thread_alloc(int ThreadId) {
+
+   uint64 size;
+   thread_t * thread;
+
+   ASSERT(ThreadId>=0&&ThreadId<MaxThreads);
+   ASSERT(Thread[ThreadId]==NULL);
+
+   // called by the owning thread so that the pages are local to it (first touch)
+
+   size = (sizeof(thread_t) + ThreadAlign - 1) & ~uint64(ThreadAlign - 1);
+
+   thread = (thread_t *) my_malloc_aligned(size,ThreadAlign);
+   memset(thread,0,size);
+
+   Thread[ThreadId] = thread;
+
+   SearchInfo[ThreadId] = thread->info;
+   SearchRoot[ThreadId] = thread->root;
+   SearchCurrent[ThreadId] = thread->current;
+   SearchBest[ThreadId] = thread->best;
+
+   pawn_alloc(ThreadId);
+   material_alloc(ThreadId);
+   eval_alloc(ThreadId);
+   search_full_alloc(ThreadId);
+}
+
+// thread_free()
+
+void thread_free(int ThreadId) {
+
+   ASSERT(ThreadId>=0&&ThreadId<MaxThreads);
+   ASSERT(Thread[ThreadId]!=NULL);
+
+   pawn_free(ThreadId);
+   material_free(ThreadId);
+   eval_free(ThreadId);
+   search_full_free(ThreadId);
+
+   SearchInfo[ThreadId] = NULL;
+   SearchRoot[ThreadId] = NULL;
+   SearchCurrent[ThreadId] = NULL;
+   SearchBest[ThreadId] = NULL;
+
+   my_free_aligned(Thread[ThreadId]);
+   Thread[ThreadId] = NULL;
+}
+
+// end of thread.cpp
+
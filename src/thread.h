@@ -0,0 +1,41 @@
+
+// thread.h
+
+#ifndef THREAD_H
+#define THREAD_H
+
+// includes
+
+#include "eval.h"
+#include "material.h"
+#include "pawn.h"
+#include "search.h"
+#include "sort.h"
+#include "util.h"
+
+// types
+
+struct thread_t { // everything a search thread owns
+   search_info_t info[1];
+   search_root_t root[1];
+   search_current_t current[1];
+   search_best_t best[MultiPVMax];
+   sort_data_t sort[1];
+   pawn_t pawn[1];
+   material_t material[1];
+   eval_cache_t eval_cache[1];
+};
+
+// variables
+
+extern thread_t * Thread[MaxThreads];
+
+// functions
+
+extern void thread_alloc (int ThreadId);
+extern void thread_free  (int ThreadId);
+
+#endif // !defined THREAD_H
+
+// end of thread.h
+
@@ -3,10 +3,28 @@
 
 // includes
 
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#  include <intrin.h>
+#endif
+
 #include "hash.h"
 #include "move.h"
 #include "option.h"
+#include "posix.h"
 #include "protocol.h"
+#include "random.h"
+#include "search.h"
 #include "trans.h"
 #include "util.h"
 #include "value.h"
@@ -18,15 +36,26 @@
 
 #define ENTRY_DATE(entry)  ((entry)->date_flags>>4)
 #define ENTRY_FLAGS(entry) ((entry)->date_flags&TransFlags)
+#define ENTRY_KEY(entry)   ((entry)->key^entry_data(entry))
 
+#define STRESS_CHECK(key)  (uint32((((key)>>16)*U64(0x9E3779B97F4A7C15))>>48)) // low 16 bits of a test key
 
-// constants
 
-static const bool UseModulo = false;
+// constants
 
 static const int DateSize = 16;
 
 static const int ClusterSize = 4; // TODO: unsigned?
+static const int ClusterAlign = 64; // one cache line per cluster
+
+static const uint64 ClearSplit = 65536; // clusters (4 MB) below which clearing is not threaded
+
+static const uint64 ReportSample = 1 << 20; // clusters scanned by trans_report()
+static const int ReportLine = 1024; // a line is sent past this, well within send()'s 4096 bytes
+static const uint64 FullSample = 1000; // clusters scanned by trans_stats()
+
+static const uint64 StressSize = 16; // clusters, small so that the threads collide
+static const int StressKeyNb = 256;
 
 static const bool AlwaysWrite = true; //was true
 
@@ -37,6 +66,9 @@ static const bool SmartReplace = true;
 
 static const int DepthNone = -128;
 
+static const char FileMagic[8] = { 'T', 'O', 'G', 'A', 'H', 'A', 'S', 'H' };
+static const uint32 FileVersion = 2; // 2: multiply-high index
+
 // types
 
 /*struct entry_t {
@@ -61,18 +93,74 @@ static const int DepthNone = -128;
    uint16 nproc; 
 };*/
 
-struct trans { // HACK: typedef'ed in trans.h
-   entry_t * table;
-   uint32 size;
-   uint32 mask;
-   int date;
-   int age[DateSize];
-   uint32 used;
+struct cluster_t {
+   entry_t entry[ClusterSize];
+};
+
+struct file_header_t { // hash file, followed by the raw cluster array
+   char magic[8];
+   uint32 version;
+   uint32 entry_size;
+   uint32 cluster_size;
+   uint32 date_size;
+   uint64 cluster_nb;
+   uint64 random;
+   uint32 date;
+   uint32 pad;
+};
+
+struct clear_t {
+   cluster_t * table;
+   uint64 size;
+   const entry_t * entry;
+};
+
+struct stat_t { // one cache line per thread
    sint64 read_nb;
    sint64 read_hit;
+   sint64 read_cut;
    sint64 write_nb;
    sint64 write_hit;
    sint64 write_collision;
+   sint64 pad[2];
+};
+
+struct resize_t {
+   trans_t * trans;
+   uint64 begin; // in the new table
+   uint64 end;
+   uint64 kept;
+   double time; // finish
+};
+
+struct stress_t {
+   trans_t * trans;
+   const uint64 * key; // [StressKeyNb]
+   int ThreadId;
+   sint64 probe_nb;
+   sint64 hit_nb;
+   sint64 torn_nb; // rejected by the key check
+   sint64 bad_nb; // accepted with another key's data
+};
+
+struct trans { // HACK: typedef'ed in trans.h
+   cluster_t * table;
+   bool large; // huge pages
+   uint64 size; // in clusters, any number (see trans_index())
+   int date;
+   int age[DateSize];
+   stat_t * stat; // [MaxThreads]
+   bool resizing;
+   cluster_t * old_table;
+   uint64 old_size;
+   double resize_start;
+   int resize_nb;
+   resize_t resize[MaxThreads];
+#ifdef _WIN32
+   HANDLE resize_handle[MaxThreads];
+#else
+   pthread_t resize_handle[MaxThreads];
+#endif
 };
 
 // variables
@@ -85,9 +173,40 @@ static void      trans_set_date (trans_t * trans, int date);
 static int       trans_age      (const trans_t * trans, int date);
 
 static entry_t * trans_entry    (trans_t * trans, uint64 key);
+static uint64    trans_index    (uint64 key, uint64 size);
+
+static uint64    trans_target   ();
+
+static void      resize_range   (resize_t * resize);
+static bool      resize_entry   (const trans_t * trans, cluster_t * cluster, const entry_t * entry, uint64 key);
+#ifdef _WIN32
+static unsigned __stdcall resize_thread (void * param);
+#else
+static void *    resize_thread  (void * param);
+#endif
+
+static void      stress_loop    (stress_t * stress);
+#ifdef _WIN32
+static unsigned __stdcall stress_thread (void * param);
+#else
+static void *    stress_thread  (void * param);
+#endif
+
+static void      file_header    (const trans_t * trans, file_header_t * header);
+static uint64    random_sum     ();
+
+static void      clear_range    (const clear_t * clear);
+#ifdef _WIN32
+static unsigned __stdcall clear_thread (void * param);
+#else
+static void *    clear_thread   (void * param);
+#endif
 
 static bool      entry_is_ok    (const entry_t * entry);
 
+static uint64    entry_data     (const entry_t * entry);
+static void      entry_write    (entry_t * entry, const entry_t * copy, uint64 key);
+
 // functions
 
 // trans_is_ok()
@@ -100,7 +219,6 @@ bool trans_is_ok(const trans_t * trans) {
 
    if (trans->table == NULL) return false;
    if (trans->size == 0) return false;
-   if (trans->mask == 0 || trans->mask >= trans->size) return false;
    if (trans->date >= DateSize) return false;
 
    for (date = 0; date < DateSize; date++) {
@@ -117,10 +235,15 @@ void trans_init(trans_t * trans) {
    ASSERT(trans!=NULL);
 
    ASSERT(sizeof(entry_t)==16);
+   ASSERT(sizeof(cluster_t)==ClusterAlign);
+   ASSERT(sizeof(stat_t)==ClusterAlign);
 
    trans->size = 0;
-   trans->mask = 0;
    trans->table = NULL;
+   trans->large = false;
+   trans->resizing = false;
+
+   trans->stat = (stat_t *) my_malloc_aligned(MaxThreads*sizeof(stat_t),ClusterAlign);
 
    trans_set_date(trans,0);
 
@@ -133,81 +256,395 @@ void trans_init(trans_t * trans) {
 
 void trans_alloc(trans_t * trans) {
 
+   uint64 size;
+   double start, alloc_time, clear_time;
+   const char * file_name;
+   char pages[64];
+
+   // allocate table
+
+   size = trans_target();
+
+   trans->size = size;
+
+   start = now_real();
+   trans->table = (cluster_t *) page_alloc((uint64) trans->size*sizeof(cluster_t),&trans->large); // page aligned
+   alloc_time = now_real() - start;
+
+   start = now_real();
+   trans_clear(trans);
+
+   clear_time = now_real() - start;
+
+   // transparent huge pages are only requested, the cleared table shows what the kernel granted
+
+   if (trans->large) {
+      sprintf(pages,"large pages");
+   } else {
+      sprintf(pages,"normal pages, %.0f MB transparent huge",double(page_huge(trans->table,trans->size*sizeof(cluster_t)))/(1024.0*1024.0));
+   }
+
+   send("info string hash %.0f MB (%s) allocated in %.0f ms, cleared in %.0f ms",
+        double(trans->size)*sizeof(cluster_t)/(1024.0*1024.0),pages,
+        alloc_time*1000.0,clear_time*1000.0);
+
+   // resume from a saved table?
+
+   file_name = option_get_string("Hash File");
+
+   if (!my_string_empty(file_name) && !my_string_equal(file_name,"<empty>")) {
+      trans_load(trans,file_name);
+   }
+
+   ASSERT(trans_is_ok());
+}
+
+// trans_target()
+
+static uint64 trans_target() {
+
    uint64 size, target;
 
-   // calculate size
+   // calculate size, no longer rounded down to a power of two
 
    target = option_get_int("Hash");
 
    if (target < 4) target = 16; // option.cpp
 
 #ifdef IS_64
-   if (target > 16384) target = 16384; // option.cpp
+   if (target > 1048576) target = 1048576; // option.cpp
 #else
    if (target > 1024) target = 1024; // option.cpp
 #endif
 
    target *= 1024 * 1024;
 
-   for (size = 1; size != 0 && size <= target; size *= 2)
-      ;
+   size = target / sizeof(cluster_t);
+   ASSERT(size!=0);
 
-   size /= 2;
-   ASSERT(size>0&&size<=target);
+   return size;
+}
 
-   // allocate table
+// trans_free()
 
-   size /= sizeof(entry_t);
-   ASSERT(size!=0&&(size&(size-1))==0); // power of 2
+void trans_free(trans_t * trans) {
 
-   trans->size = (uint32) size + (ClusterSize - 1); // HACK to avoid testing for end of table
-   trans->mask = (uint32) size - 1;
+   trans_wait(trans);
 
-   trans->table = (entry_t *)my_malloc(Trans->size*sizeof(entry_t));
+   ASSERT(trans_is_ok(trans));
 
-   trans_clear(trans);
+   page_free(trans->table,(uint64)trans->size*sizeof(cluster_t));
 
-   ASSERT(trans_is_ok());
+   trans->table = NULL;
+   trans->size = 0;
 }
 
-// trans_free()
+// trans_resize()
 
-void trans_free(trans_t * trans) {
+void trans_resize(trans_t * trans) {
+
+   uint64 size, slice;
+   int i;
 
    ASSERT(trans_is_ok(trans));
 
-   my_free(trans->table);
+   trans_wait(trans); // previous resize
 
-   trans->table = NULL;
-   trans->size = 0;
-   trans->mask = 0;
+   size = trans_target();
+   if (size == trans->size) return;
+
+   // switch to the new table, the old one is migrated and freed in trans_wait()
+
+   trans->resizing = true;
+   trans->resize_start = now_real();
+
+   trans->old_table = trans->table;
+   trans->old_size = trans->size;
+
+   trans->table = (cluster_t *) page_alloc(size*sizeof(cluster_t),&trans->large);
+   trans->size = size;
+
+   // the index grows with the key in both tables, so each thread owns a range
+   // of the new table and only reads the old clusters that map into it
+
+   trans->resize_nb = NumberThreads;
+   if (trans->resize_nb < 1 || size < ClearSplit) trans->resize_nb = 1;
+   if (trans->resize_nb > MaxThreads) trans->resize_nb = MaxThreads;
+
+   slice = size / trans->resize_nb;
+
+   for (i = 0; i < trans->resize_nb; i++) {
+
+      trans->resize[i].trans = trans;
+      trans->resize[i].begin = slice * i;
+      trans->resize[i].end = (i == trans->resize_nb - 1) ? size : slice * (i + 1);
+      trans->resize[i].kept = 0;
+
+#ifdef _WIN32
+      trans->resize_handle[i] = (HANDLE) _beginthreadex(NULL,0,&resize_thread,&trans->resize[i],0,NULL);
+#else
+      pthread_create(&trans->resize_handle[i],NULL,resize_thread,&trans->resize[i]);
+#endif
+   }
+
+   send("info string hash resizing from %.0f MB to %.0f MB in the background",
+        double(trans->old_size)*sizeof(cluster_t)/(1024.0*1024.0),double(size)*sizeof(cluster_t)/(1024.0*1024.0));
 }
 
+// trans_wait()
+
+void trans_wait(trans_t * trans) {
+
+   uint64 kept;
+   double time;
+   int i;
+
+   ASSERT(trans!=NULL);
+
+   if (!trans->resizing) return;
+
+   kept = 0;
+   time = trans->resize_start;
+
+   for (i = 0; i < trans->resize_nb; i++) {
+#ifdef _WIN32
+      WaitForSingleObject(trans->resize_handle[i],INFINITE);
+      CloseHandle(trans->resize_handle[i]);
+#else
+      pthread_join(trans->resize_handle[i],NULL);
+#endif
+      kept += trans->resize[i].kept;
+      if (trans->resize[i].time > time) time = trans->resize[i].time;
+   }
+
+   page_free(trans->old_table,(uint64)trans->old_size*sizeof(cluster_t));
+
+   trans->old_table = NULL;
+   trans->old_size = 0;
+   trans->resizing = false;
+
+   send("info string hash resized in %.0f ms, " S64_FORMAT " entries migrated",(time-trans->resize_start)*1000.0,kept);
+
+   ASSERT(trans_is_ok(trans));
+}
+
+// resize_range()
+
+static void resize_range(resize_t * resize) {
+
+   const trans_t * trans;
+   entry_t clear_entry[1];
+   entry_t copy[1];
+   uint64 index, begin, end;
+   uint64 key;
+   int i;
+
+   ASSERT(resize!=NULL);
+
+   trans = resize->trans;
+
+   clear_entry->move = MoveNone;
+   clear_entry->depth = DepthNone;
+   clear_entry->date_flags = (trans->date << 4);
+   clear_entry->value = 0;
+   clear_entry->nproc = 0;
+   clear_entry->key = entry_data(clear_entry); // key 0
+
+   // clear the new clusters of this range
+
+   for (index = resize->begin; index < resize->end; index++) {
+      for (i = 0; i < ClusterSize; i++) trans->table[index].entry[i] = *clear_entry;
+   }
+
+   // re-bucket the old ones, the range is rounded outwards and then filtered
+
+   begin = uint64(double(resize->begin) / double(trans->size) * double(trans->old_size));
+   end = uint64(double(resize->end) / double(trans->size) * double(trans->old_size)) + 2;
+
+   begin = (begin > 1) ? begin - 2 : 0;
+   if (end > trans->old_size) end = trans->old_size;
+
+   for (index = begin; index < end; index++) {
+
+      for (i = 0; i < ClusterSize; i++) {
+
+         *copy = trans->old_table[index].entry[i];
+         key = ENTRY_KEY(copy);
+         if (key == 0) continue;
+
+         ASSERT(trans_index(key,trans->old_size)==index);
+
+         if (trans_index(key,trans->size) < resize->begin || trans_index(key,trans->size) >= resize->end) continue; // another thread's
+
+         if (resize_entry(trans,&trans->table[trans_index(key,trans->size)],copy,key)) {
+            resize->kept++;
+         }
+      }
+   }
+
+   resize->time = now_real();
+}
+
+// resize_entry()
+
+static bool resize_entry(const trans_t * trans, cluster_t * cluster, const entry_t * entry, uint64 key) {
+
+   entry_t copy[1];
+   int score, best_score;
+   int i, best;
+
+   ASSERT(trans!=NULL);
+   ASSERT(cluster!=NULL);
+   ASSERT(entry!=NULL);
+
+   // same replacement scheme as trans_store(), but never evict a better entry
+
+   best = -1;
+   best_score = trans->age[ENTRY_DATE(entry)] * 256 - entry->depth;
+   if (SmartReplace) best_score = best_score * 4 - ENTRY_FLAGS(entry);
+
+   for (i = 0; i < ClusterSize; i++) {
+
+      *copy = cluster->entry[i];
+
+      if (ENTRY_KEY(copy) == 0) { // empty
+         best = i;
+         break;
+      }
+
+      score = trans->age[ENTRY_DATE(copy)] * 256 - copy->depth;
+      if (SmartReplace) score = score * 4 - ENTRY_FLAGS(copy);
+
+      if (score > best_score) {
+         best = i;
+         best_score = score;
+      }
+   }
+
+   if (best < 0) return false;
+
+   entry_write(&cluster->entry[best],entry,key);
+
+   return true;
+}
+
+// resize_thread()
+
+#ifdef _WIN32
+static unsigned __stdcall resize_thread(void * param) {
+
+   resize_range((resize_t *) param);
+
+   return 0;
+}
+#else
+static void * resize_thread(void * param) {
+
+   resize_range((resize_t *) param);
+
+   return NULL;
+}
+#endif
+
 // trans_clear()
 
 void trans_clear(trans_t * trans) {
 
    entry_t clear_entry[1];
-   entry_t * entry;
-   uint32 index;
+   clear_t clear[MaxThreads];
+   int thread_nb;
+   uint64 slice;
+   int i;
+#ifdef _WIN32
+   HANDLE handle[MaxThreads];
+#else
+   pthread_t handle[MaxThreads];
+#endif
 
    ASSERT(trans!=NULL);
 
+   trans_wait(trans);
+
    trans_set_date(trans,0);
 
-   clear_entry->key = 0;
    clear_entry->move = MoveNone;
    clear_entry->depth = DepthNone;
    clear_entry->date_flags = (trans->date << 4);
+   clear_entry->value = 0;
+   clear_entry->nproc = 0;
+   clear_entry->key = entry_data(clear_entry); // key 0
       
    ASSERT(entry_is_ok(clear_entry));
 
-   entry = trans->table;
+   // split the table between the search threads, this only spreads the zeroing
+   // work: page_alloc() interleaves the pages over the NUMA nodes already
+
+   thread_nb = NumberThreads;
+   if (thread_nb < 1 || trans->size < ClearSplit) thread_nb = 1;
+   if (thread_nb > MaxThreads) thread_nb = MaxThreads;
+
+   slice = trans->size / thread_nb;
 
-   for (index = 0; index < trans->size; index++) {
-      *entry++ = *clear_entry;
+   for (i = 0; i < thread_nb; i++) {
+      clear[i].table = trans->table + slice * i;
+      clear[i].size = (i == thread_nb - 1) ? trans->size - slice * i : slice;
+      clear[i].entry = clear_entry;
    }
+
+   for (i = 1; i < thread_nb; i++) {
+#ifdef _WIN32
+      handle[i] = (HANDLE) _beginthreadex(NULL,0,&clear_thread,&clear[i],0,NULL);
+#else
+      pthread_create(&handle[i],NULL,clear_thread,&clear[i]);
+#endif
+   }
+
+   clear_range(&clear[0]);
+
+   for (i = 1; i < thread_nb; i++) {
+#ifdef _WIN32
+      WaitForSingleObject(handle[i],INFINITE);
+      CloseHandle(handle[i]);
+#else
+      pthread_join(handle[i],NULL);
+#endif
+   }
+}
+
+// clear_range()
+
+static void clear_range(const clear_t * clear) {
+
+   cluster_t * cluster;
+   uint64 index;
+   int i;
+
+   ASSERT(clear!=NULL);
+
+   cluster = clear->table;
+
+   for (index = 0; index < clear->size; index++, cluster++) {
+      for (i = 0; i < ClusterSize; i++) cluster->entry[i] = *clear->entry;
+   }
+}
+
+// clear_thread()
+
+#ifdef _WIN32
+static unsigned __stdcall clear_thread(void * param) {
+
+   clear_range((const clear_t *) param);
+
+   return 0;
+}
+#else
+static void * clear_thread(void * param) {
+
+   clear_range((const clear_t *) param);
+
+   return NULL;
 }
+#endif
 
 // trans_inc_date()
 
@@ -218,6 +655,97 @@ void trans_inc_date(trans_t * trans) {
    trans_set_date(trans,(trans->date+1)%DateSize);
 }
 
+// trans_save()
+
+bool trans_save(const trans_t * trans, const char file_name[]) {
+
+   FILE * file;
+   file_header_t header[1];
+   bool ok;
+
+   ASSERT(file_name!=NULL);
+
+   trans_wait((trans_t *) trans); // HACK: const
+
+   ASSERT(trans_is_ok(trans));
+
+   file = fopen(file_name,"wb");
+
+   if (file == NULL) {
+      send("info string cannot write hash file \"%s\": %s",file_name,strerror(errno));
+      return false;
+   }
+
+   file_header(trans,header);
+
+   ok = fwrite(header,sizeof(file_header_t),1,file) == 1
+     && fwrite(trans->table,sizeof(cluster_t),trans->size,file) == trans->size;
+
+   if (fclose(file) == EOF) ok = false;
+
+   if (ok) {
+      send("info string hash saved to \"%s\"",file_name);
+   } else {
+      send("info string error writing hash file \"%s\"",file_name);
+   }
+
+   return ok;
+}
+
+// trans_load()
+
+bool trans_load(trans_t * trans, const char file_name[]) {
+
+   FILE * file;
+   file_header_t header[1], saved[1];
+
+   ASSERT(file_name!=NULL);
+
+   trans_wait(trans);
+
+   ASSERT(trans_is_ok(trans));
+
+   file = fopen(file_name,"rb");
+   if (file == NULL) return false; // nothing saved yet
+
+   file_header(trans,header);
+
+   if (fread(saved,sizeof(file_header_t),1,file) != 1
+    || memcmp(saved->magic,header->magic,sizeof(FileMagic)) != 0
+    || saved->version != header->version
+    || saved->entry_size != header->entry_size
+    || saved->cluster_size != header->cluster_size
+    || saved->date_size != header->date_size
+    || saved->random != header->random
+    || saved->date >= uint32(DateSize)) {
+
+      fclose(file);
+      send("info string hash file \"%s\" ignored: incompatible format",file_name);
+      return false;
+   }
+
+   if (saved->cluster_nb != header->cluster_nb) {
+      fclose(file);
+      send("info string hash file \"%s\" ignored: saved with %.0f MB",file_name,double(saved->cluster_nb)*sizeof(cluster_t)/(1024.0*1024.0));
+      return false;
+   }
+
+   if (fread(trans->table,sizeof(cluster_t),trans->size,file) != trans->size) {
+      fclose(file);
+      trans_clear(trans); // partly overwritten
+      send("info string hash file \"%s\" ignored: truncated",file_name);
+      return false;
+   }
+
+   fclose(file);
+
+   trans_set_date(trans,saved->date); // keep the saved entries' age
+
+   send("info string hash loaded from \"%s\"",file_name);
+
+   return true;
+}
+
 // trans_set_date()
 
 static void trans_set_date(trans_t * trans, int date) {
@@ -231,12 +759,7 @@ static void trans_set_date(trans_t * trans, int date) {
       trans->age[date] = trans_age(trans,date);
    }
 
-   trans->used = 0;
-   trans->read_nb = 0;
-   trans->read_hit = 0;
-   trans->write_nb = 0;
-   trans->write_hit = 0;
-   trans->write_collision = 0;
+   memset(trans->stat,0,MaxThreads*sizeof(stat_t));
 }
 
 // trans_age()
@@ -258,9 +781,11 @@ static int trans_age(const trans_t * trans, int date) {
 
 // trans_store()
 
-void trans_store(trans_t * trans, uint64 key, int move, int depth, int flags, int value) {
+void trans_store(trans_t * trans, uint64 key, int move, int depth, int flags, int value, int ThreadId) {
 
    entry_t * entry, * best_entry;
+   entry_t copy[1];
+   stat_t * stat;
    int score, best_score;
    int i;
 
@@ -269,10 +794,12 @@ void trans_store(trans_t * trans, uint64 key, int move, int depth, int flags, in
    ASSERT(depth>=0&&depth<256);
    ASSERT((flags&~TransFlags)==0);
    ASSERT(value>=-32767&&value<=+32767);
+   ASSERT(ThreadId>=0&&ThreadId<MaxThreads);
    
    // init
 
-   trans->write_nb++;
+   stat = &trans->stat[ThreadId];
+   stat->write_nb++;
 
    // probe
 
@@ -283,41 +810,43 @@ void trans_store(trans_t * trans, uint64 key, int move, int depth, int flags, in
 
    for (i = 0; i < ClusterSize; i++, entry++) {
 
-      if (entry->key == key) {
+      *copy = *entry; // snapshot, other threads may be writing
+
+      if (ENTRY_KEY(copy) == key) {
 
          // hash hit => update existing entry
 
-         trans->write_hit++;
-         if (ENTRY_DATE(entry) != trans->date) trans->used++;
+         stat->write_hit++;
 
-         if (entry->depth <= depth) {
+         if (copy->depth <= depth) {
 
-            if (SmartMove && move == MoveNone) move = entry->move;
-            if (SmartValue && entry->depth == depth && entry->value == value) {
-               flags |= ENTRY_FLAGS(entry); // HACK
+            if (SmartMove && move == MoveNone) move = copy->move;
+            if (SmartValue && copy->depth == depth && copy->value == value) {
+               flags |= ENTRY_FLAGS(copy); // HACK
             }
 
-            ASSERT(entry->key==key);
-            entry->move = move;
-            entry->depth = depth;
-            entry->date_flags = (trans->date << 4) | flags;
-            entry->value = value;
-            //entry->size = node_nb; // TODO: 64->16 mapping
+            copy->move = move;
+            copy->depth = depth;
+            copy->date_flags = (trans->date << 4) | flags;
+            copy->value = value;
+            //copy->size = node_nb; // TODO: 64->16 mapping
 
          } else { // deeper entry
 
-            if (SmartMove && entry->move == MoveNone) entry->move = move;
-            entry->date_flags = (trans->date << 4) | ENTRY_FLAGS(entry);
+            if (SmartMove && copy->move == MoveNone) copy->move = move;
+            copy->date_flags = (trans->date << 4) | ENTRY_FLAGS(copy);
          }
 
+         entry_write(entry,copy,key);
+
          return;
       }
 
 
       // evaluate replacement score
 
-      score = trans->age[ENTRY_DATE(entry)] * 256 - entry->depth;
-		if (SmartReplace) score = score * 4 - ENTRY_FLAGS(entry);
+      score = trans->age[ENTRY_DATE(copy)] * 256 - copy->depth;
+		if (SmartReplace) score = score * 4 - ENTRY_FLAGS(copy);
 
       ASSERT(score>-32767);
 
@@ -331,51 +860,49 @@ void trans_store(trans_t * trans, uint64 key, int move, int depth, int flags, in
 
    entry = best_entry;
    ASSERT(entry!=NULL);
-   ASSERT(entry->key!=key);
 
-   if (ENTRY_DATE(entry) == trans->date) {
+   *copy = *entry;
 
-      trans->write_collision++;
+   if (ENTRY_DATE(copy) == trans->date) {
 
-      if (!AlwaysWrite && entry->depth > depth) {
+      stat->write_collision++;
+
+      if (!AlwaysWrite && copy->depth > depth) {
          return; // do not replace deeper entries
       }
-
-   } else {
-
-      trans->used++;
    }
 
    // store
 
-   ASSERT(entry!=NULL);
-
-   entry->key = key;
-   entry->move = move;
-   entry->depth = depth;
-   entry->date_flags = (trans->date << 4) | flags;
-   entry->value = value;
-   // entry->size = node_nb; // TODO: 64->16 mapping
+   copy->move = move;
+   copy->depth = depth;
+   copy->date_flags = (trans->date << 4) | flags;
+   copy->value = value;
+   copy->nproc = 0;
+   // copy->size = node_nb; // TODO: 64->16 mapping
 
+   entry_write(entry,copy,key);
 }
 
 
 // trans_retrieve()
 
-bool trans_retrieve(trans_t * trans, entry_t ** found_entry, uint64 key, int * move, int * depth, int * flags, int * value) {
+bool trans_retrieve(trans_t * trans, entry_t ** found_entry, uint64 key, int * move, int * depth, int * flags, int * value, int ThreadId) {
 
    int i;
    entry_t * entry;
+   entry_t copy[1];
 
    ASSERT(trans_is_ok(trans));
    ASSERT(move!=NULL);
    ASSERT(depth!=NULL);
    ASSERT(flags!=NULL);
    ASSERT(value!=NULL);
+   ASSERT(ThreadId>=0&&ThreadId<MaxThreads);
 
    // init
 
-   trans->read_nb++;
+   trans->stat[ThreadId].read_nb++;
 
    // probe
 
@@ -383,16 +910,18 @@ bool trans_retrieve(trans_t * trans, entry_t ** found_entry, uint64 key, int * m
 
    for (i = 0; i < ClusterSize; i++, entry++) {
 
-      if (entry->key == key) {
+      *copy = *entry; // snapshot, a torn read fails the key test below
+
+      if (ENTRY_KEY(copy) == key) {
 
          // found
 
-         trans->read_hit++;
+         trans->stat[ThreadId].read_hit++;
 
-         *move  = entry->move;
-         *depth = entry->depth;
-         *flags = ENTRY_FLAGS(entry);
-         *value = entry->value;
+         *move  = copy->move;
+         *depth = copy->depth;
+         *flags = ENTRY_FLAGS(copy);
+         *value = copy->value;
 
 		 *found_entry = entry;
          return true;
@@ -405,39 +934,405 @@ bool trans_retrieve(trans_t * trans, entry_t ** found_entry, uint64 key, int * m
    return false;
 }
 
+// trans_prefetch()
+
+void trans_prefetch(trans_t * trans, uint64 key) {
+
+   ASSERT(trans_is_ok(trans));
+
+   PREFETCH(trans_entry(trans,key)); // the whole cluster is one cache line
+}
+
+// trans_cutoff()
+
+void trans_cutoff(trans_t * trans, int ThreadId) {
+
+   ASSERT(trans!=NULL);
+   ASSERT(ThreadId>=0&&ThreadId<MaxThreads);
+
+   trans->stat[ThreadId].read_cut++; // the retrieved entry ended the node
+}
+
 // trans_stats()
 
 void trans_stats(const trans_t * trans) {
 
-   double full;
-   // double hit, collision;
+   entry_t copy[1];
+   uint64 index, sample;
+   sint64 used;
+   int i;
 
    ASSERT(trans_is_ok(trans));
 
-   full = double(trans->used) / double(trans->size);
-   // hit = double(trans->read_hit) / double(trans->read_nb);
-   // collision = double(trans->write_collision) / double(trans->write_nb);
+   // entries written in this search among the first clusters, the keys are uniform over the table
 
-   send("info hashfull %.0f",full*1000.0);
+   sample = MIN(trans->size,FullSample);
+   used = 0;
+
+   for (index = 0; index < sample; index++) {
+      for (i = 0; i < ClusterSize; i++) {
+         *copy = trans->table[index].entry[i];
+         if (ENTRY_KEY(copy) != 0 && ENTRY_DATE(copy) == trans->date) used++;
+      }
+   }
+
+   send("info hashfull %.0f",1000.0*double(used)/(double(sample)*ClusterSize));
+}
+
+// trans_hits()
+
+void trans_hits(const trans_t * trans, sint64 * read_nb, sint64 * read_hit) {
+
+   const volatile stat_t * stat;
+   int ThreadId;
+
+   ASSERT(trans_is_ok(trans));
+   ASSERT(read_nb!=NULL);
+   ASSERT(read_hit!=NULL);
+
+   // the counters are still moving, each one is owned by a single thread
+
+   *read_nb = 0;
+   *read_hit = 0;
+
+   for (ThreadId = 0; ThreadId < NumberThreads; ThreadId++) {
+      stat = &trans->stat[ThreadId];
+      *read_nb += stat->read_nb;
+      *read_hit += stat->read_hit;
+   }
+}
+
+// trans_report()
+
+void trans_report(const trans_t * trans) {
+
+   stat_t total[1];
+   const stat_t * stat;
+   sint64 depth_nb[256];
+   sint64 age_nb[DateSize];
+   sint64 entry_nb;
+   entry_t copy[1];
+   uint64 index, sample;
+   int ThreadId, i, depth, age;
+   char string[4096];
+   int pos;
+
+   ASSERT(trans_is_ok(trans));
+
+   // merge the per-thread counters (last search)
+
+   memset(total,0,sizeof(stat_t));
+
+   for (ThreadId = 0; ThreadId < MaxThreads; ThreadId++) {
+
+      stat = &trans->stat[ThreadId];
+      if (stat->read_nb == 0 && stat->write_nb == 0) continue;
+
+      if (ThreadId < NumberThreads) {
+         send("info string hash thread %d probes " S64_FORMAT " hit %.1f%% cut %.1f%% stores " S64_FORMAT " collision %.1f%%",
+              ThreadId,stat->read_nb,
+              100.0*double(stat->read_hit)/double(MAX(stat->read_nb,1)),
+              100.0*double(stat->read_cut)/double(MAX(stat->read_nb,1)),
+              stat->write_nb,
+              100.0*double(stat->write_collision)/double(MAX(stat->write_nb,1)));
+      }
+
+      total->read_nb += stat->read_nb;
+      total->read_hit += stat->read_hit;
+      total->read_cut += stat->read_cut;
+      total->write_nb += stat->write_nb;
+      total->write_hit += stat->write_hit;
+      total->write_collision += stat->write_collision;
+   }
+
+   send("info string hash total probes " S64_FORMAT " hit %.1f%% cut %.1f%% stores " S64_FORMAT " update %.1f%% collision %.1f%%",
+        total->read_nb,
+        100.0*double(total->read_hit)/double(MAX(total->read_nb,1)),
+        100.0*double(total->read_cut)/double(MAX(total->read_nb,1)),
+        total->write_nb,
+        100.0*double(total->write_hit)/double(MAX(total->write_nb,1)),
+        100.0*double(total->write_collision)/double(MAX(total->write_nb,1)));
+
+   // scan (the start of) the table
+
+   for (i = 0; i < 256; i++) depth_nb[i] = 0;
+   for (i = 0; i < DateSize; i++) age_nb[i] = 0;
+   entry_nb = 0;
+
+   sample = MIN(trans->size,ReportSample);
+
+   for (index = 0; index < sample; index++) {
+      for (i = 0; i < ClusterSize; i++) {
+         *copy = trans->table[index].entry[i];
+         if (ENTRY_KEY(copy) == 0) continue; // empty
+         entry_nb++;
+         depth_nb[copy->depth]++;
+         age_nb[trans->age[ENTRY_DATE(copy)]]++;
+      }
+   }
+
+   send("info string hash size %.0f MB entries " S64_FORMAT " of %.0f sampled (%.1f%% full)",
+        double(trans->size)*sizeof(cluster_t)/(1024.0*1024.0),entry_nb,double(sample)*ClusterSize,
+        100.0*double(entry_nb)/(double(sample)*ClusterSize));
+
+   // a bucket takes at most 26 characters, all 256 depths would not fit in one line
+
+   pos = sprintf(string,"info string hash depth");
+   for (depth = -128; depth < 128; depth++) { // stored as uint8
+      if (depth_nb[uint8(depth)] == 0) continue;
+      if (pos > ReportLine) {
+         send("%s",string);
+         pos = sprintf(string,"info string hash depth");
+      }
+      pos += sprintf(&string[pos]," %d:" S64_FORMAT,depth,depth_nb[uint8(depth)]);
+   }
+   send("%s",string);
+
+   pos = sprintf(string,"info string hash age");
+   for (age = 0; age < DateSize; age++) {
+      if (age_nb[age] == 0) continue;
+      if (pos > ReportLine) {
+         send("%s",string);
+         pos = sprintf(string,"info string hash age");
+      }
+      pos += sprintf(&string[pos]," %d:" S64_FORMAT,age,age_nb[age]);
+   }
+   send("%s",string);
+}
+
+// trans_stress()
+
+void trans_stress(sint64 probe_nb) {
+
+   trans_t trans[1];
+   stress_t stress[MaxThreads];
+   uint64 key[StressKeyNb];
+   sint64 total_nb, hit_nb, torn_nb, bad_nb;
+   int thread_nb;
+   int i;
+   double start;
+#ifdef _WIN32
+   HANDLE handle[MaxThreads];
+#else
+   pthread_t handle[MaxThreads];
+#endif
+
+   ASSERT(probe_nb>0);
+
+   // a private table small enough for every store to land on another thread's clusters
+
+   memset(trans,0,sizeof(trans_t));
+
+   trans->size = StressSize;
+   trans->table = (cluster_t *) my_malloc_aligned(StressSize*sizeof(cluster_t),ClusterAlign);
+   trans->stat = (stat_t *) my_malloc_aligned(MaxThreads*sizeof(stat_t),ClusterAlign);
+
+   trans_clear(trans);
+
+   // test keys carry a checksum, so that a torn entry shows up as a foreign key
+
+   for (i = 0; i < StressKeyNb; i++) {
+      key[i] = (RANDOM_64(i) & ~U64(0xFFFF)) | U64(0x10000); // never 0
+      key[i] |= STRESS_CHECK(key[i]);
+   }
+
+   thread_nb = NumberThreads;
+   if (thread_nb < 1) thread_nb = 1;
+   if (thread_nb > MaxThreads) thread_nb = MaxThreads;
+
+   for (i = 0; i < thread_nb; i++) {
+      stress[i].trans = trans;
+      stress[i].key = key;
+      stress[i].ThreadId = i;
+      stress[i].probe_nb = probe_nb;
+      stress[i].hit_nb = 0;
+      stress[i].torn_nb = 0;
+      stress[i].bad_nb = 0;
+   }
+
+   start = now_real();
+
+   for (i = 1; i < thread_nb; i++) {
+#ifdef _WIN32
+      handle[i] = (HANDLE) _beginthreadex(NULL,0,&stress_thread,&stress[i],0,NULL);
+#else
+      pthread_create(&handle[i],NULL,stress_thread,&stress[i]);
+#endif
+   }
+
+   stress_loop(&stress[0]);
+
+   for (i = 1; i < thread_nb; i++) {
+#ifdef _WIN32
+      WaitForSingleObject(handle[i],INFINITE);
+      CloseHandle(handle[i]);
+#else
+      pthread_join(handle[i],NULL);
+#endif
+   }
+
+   // report
+
+   total_nb = 0;
+   hit_nb = 0;
+   torn_nb = 0;
+   bad_nb = 0;
+
+   for (i = 0; i < thread_nb; i++) {
+      total_nb += stress[i].probe_nb;
+      hit_nb += stress[i].hit_nb;
+      torn_nb += stress[i].torn_nb;
+      bad_nb += stress[i].bad_nb;
+   }
+
+   send("info string hashstress threads %d probes " S64_FORMAT " hits " S64_FORMAT " torn rejected " S64_FORMAT " torn accepted " S64_FORMAT " time %.0f",
+        thread_nb,total_nb,hit_nb,torn_nb,bad_nb,(now_real()-start)*1000.0);
+
+   my_free_aligned(trans->table);
+   my_free_aligned(trans->stat);
+}
+
+// stress_loop()
+
+static void stress_loop(stress_t * stress) {
+
+   entry_t copy[1];
+   uint64 random, key, entry_key;
+   sint64 i;
+   int move, depth, flags, value;
+   int j;
+   entry_t * entry;
+
+   ASSERT(stress!=NULL);
+
+   random = stress->key[stress->ThreadId] | 1; // xorshift state, different per thread
+
+   for (i = 0; i < stress->probe_nb; i++) {
+
+      random ^= random << 13;
+      random ^= random >> 7;
+      random ^= random << 17;
+
+      key = stress->key[random%StressKeyNb];
+
+      // the data is a function of the key, any mix of two entries is detectable
+
+      if ((random >> 32) & 1) {
+
+         trans_store(stress->trans,key,1+int((key>>16)&0x7FFF),int((key>>32)&0x3F),TransExact,int((key>>40)&0xFFF),stress->ThreadId);
+
+      } else if (trans_retrieve(stress->trans,&entry,key,&move,&depth,&flags,&value,stress->ThreadId)) {
+
+         stress->hit_nb++;
+
+         if (move != 1+int((key>>16)&0x7FFF) || depth != int((key>>32)&0x3F) || flags != TransExact || value != int((key>>40)&0xFFF)) {
+            stress->bad_nb++;
+         }
+      }
+
+      // torn entries in the probed cluster
+
+      entry = trans_entry(stress->trans,key);
+
+      for (j = 0; j < ClusterSize; j++) {
+         *copy = entry[j];
+         entry_key = ENTRY_KEY(copy);
+         if (entry_key != 0 && (entry_key & 0xFFFF) != STRESS_CHECK(entry_key)) stress->torn_nb++;
+      }
+   }
+}
+
+// stress_thread()
+
+#ifdef _WIN32
+static unsigned __stdcall stress_thread(void * param) {
+
+   stress_loop((stress_t *) param);
+
+   return 0;
+}
+#else
+static void * stress_thread(void * param) {
+
+   stress_loop((stress_t *) param);
+
+   return NULL;
+}
+#endif
+
+// file_header()
+
+static void file_header(const trans_t * trans, file_header_t * header) {
+
+   ASSERT(trans_is_ok(trans));
+   ASSERT(header!=NULL);
+
+   memset(header,0,sizeof(file_header_t));
+
+   memcpy(header->magic,FileMagic,sizeof(FileMagic));
+   header->version = FileVersion;
+   header->entry_size = sizeof(entry_t);
+   header->cluster_size = ClusterSize;
+   header->date_size = DateSize;
+   header->cluster_nb = trans->size;
+   header->random = random_sum();
+   header->date = trans->date;
+}
+
+// random_sum()
+
+static uint64 random_sum() {
+
+   uint64 sum;
+   int i;
+
+   // keys are only meaningful with the same Zobrist numbers
+
+   sum = 0;
+   for (i = 0; i < RandomNb; i++) sum = sum * 3 + RANDOM_64(i);
+
+   return sum;
 }
 
 // trans_entry()
 
 static entry_t * trans_entry(trans_t * trans, uint64 key) {
 
-   uint32 index;
+   uint64 index;
 
    ASSERT(trans_is_ok(trans));
 
-   if (UseModulo) {
-      index = key % (trans->mask + 1);
-   } else {
-      index = key & trans->mask;
-   }
+   index = trans_index(key,trans->size);
+   ASSERT(index<trans->size);
+
+   return &trans->table[index].entry[0];
+}
+
+// trans_index()
+
+static uint64 trans_index(uint64 key, uint64 size) {
+
+   ASSERT(size!=0);
+
+   // the high half of key * size maps the key range onto [0,size) without a
+   // division, so that any size works and the index grows with the key
+
+#if defined(__SIZEOF_INT128__)
+   return uint64(((unsigned __int128) key * size) >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+   return __umulh(key,size);
+#else
+   uint64 key_lo, key_hi, size_lo, size_hi, mid;
 
-   ASSERT(index<=trans->mask);
+   key_lo = key & 0xFFFFFFFF;
+   key_hi = key >> 32;
+   size_lo = size & 0xFFFFFFFF;
+   size_hi = size >> 32;
 
-   return &trans->table[index];
+   mid = ((key_lo * size_lo) >> 32) + (key_hi * size_lo & 0xFFFFFFFF) + key_lo * size_hi;
+
+   return key_hi * size_hi + (key_hi * size_lo >> 32) + (mid >> 32);
+#endif
 }
 
 // entry_is_ok()
@@ -453,5 +1348,37 @@ static bool entry_is_ok(const entry_t * entry) {
    return true;
 }
 
+// entry_data()
+
+static uint64 entry_data(const entry_t * entry) {
+
+   uint64 data;
+
+   ASSERT(entry!=NULL);
+   ASSERT(sizeof(entry_t)==sizeof(uint64)*2);
+
+   memcpy(&data,&entry->move,sizeof(data)); // move .. nproc as one 64-bit word
+
+   return data;
+}
+
+// entry_write()
+
+static void entry_write(entry_t * entry, const entry_t * copy, uint64 key) {
+
+   uint64 data;
+
+   ASSERT(entry!=NULL);
+   ASSERT(copy!=NULL);
+
+   // lockless hashing (Hyatt & Mann): the key is stored XOR-ed with the data,
+   // so that an entry torn by concurrent writers can never pass the key test
+
+   data = entry_data(copy);
+
+   memcpy(&entry->move,&data,sizeof(data));
+   entry->key = key ^ data;
+}
+
 // end of trans.cpp
 
@@ -26,7 +26,7 @@ const int TransFlags   = 3;
 #define TRANS_IS_EXACT(flags) ((flags)==TransExact)
 
 struct entry_t {
-   uint64 key;
+   uint64 key; // XOR-ed with the data word below (lockless hashing)
    uint16 move;
    uint8 depth;
    uint8 date_flags;
@@ -51,13 +51,25 @@ extern void trans_init     (trans_t * trans);
 extern void trans_alloc    (trans_t * trans);
 extern void trans_free     (trans_t * trans);
 
+extern void trans_resize   (trans_t * trans);
+extern void trans_wait     (trans_t * trans);
+
 extern void trans_clear    (trans_t * trans);
 extern void trans_inc_date (trans_t * trans);
 
-extern void trans_store    (trans_t * trans, uint64 key, int move, int depth, int flags, int value);
-extern bool trans_retrieve (trans_t * trans, entry_t ** found_entry, uint64 key, int * move, int * depth, int * flags, int * value);
+extern bool trans_save     (const trans_t * trans, const char file_name[]);
+extern bool trans_load     (trans_t * trans, const char file_name[]);
+
+extern void trans_store    (trans_t * trans, uint64 key, int move, int depth, int flags, int value, int ThreadId);
+extern bool trans_retrieve (trans_t * trans, entry_t ** found_entry, uint64 key, int * move, int * depth, int * flags, int * value, int ThreadId);
+extern void trans_cutoff   (trans_t * trans, int ThreadId);
+
+extern void trans_prefetch (trans_t * trans, uint64 key);
 
 extern void trans_stats    (const trans_t * trans);
+extern void trans_hits     (const trans_t * trans, sint64 * read_nb, sint64 * read_hit);
+extern void trans_report   (const trans_t * trans);
+extern void trans_stress   (sint64 probe_nb);
 
 #endif // !defined TRANS_H
 
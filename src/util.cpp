@@ -86,6 +86,36 @@ void my_free(void * address) {
    free(address);
 }
 
+// my_malloc_aligned()
+
+void * my_malloc_aligned(uint64 size, int alignment) {
+
+   char * block, * address;
+
+   ASSERT(size>0);
+   ASSERT(alignment>=int(sizeof(void *))&&(alignment&(alignment-1))==0);
+
+   // over-allocate and keep the malloc() block just below the aligned address
+
+   block = (char *) my_malloc(size+alignment);
+
+   address = block + sizeof(void *);
+   address += (alignment - (uint64)(size_t)address % alignment) % alignment;
+
+   ((void * *) address)[-1] = block;
+
+   return address;
+}
+
+// my_free_aligned()
+
+void my_free_aligned(void * address) {
+
+   ASSERT(address!=NULL);
+
+   my_free(((void * *) address)[-1]);
+}
+
 // my_fatal()
 
 void my_fatal(const char format[], ...) {
@@ -48,6 +48,15 @@
 #  define ASSERT(a)
 #endif
 
+#if defined(__GNUC__)
+#  define PREFETCH(address) __builtin_prefetch((const void *)(address))
+#elif defined(_MSC_VER)
+#  include <xmmintrin.h>
+#  define PREFETCH(address) _mm_prefetch((const char *)(address),_MM_HINT_T0)
+#else
+#  define PREFETCH(address)
+#endif
+
 #if !defined(IS_32) && !defined(IS_64)
 #  ifdef __GNUC__
 #     define IS_UNIX TRUE
@@ -118,6 +127,9 @@ extern int    my_round              (double x);
 extern void * my_malloc             (uint64 size);
 extern void   my_free               (void * address);
 
+extern void * my_malloc_aligned     (uint64 size, int alignment);
+extern void   my_free_aligned       (void * address);
+
 extern void   my_fatal              (const char format[], ...);
 
 extern bool   my_file_read_line     (FILE * file, char string[], int size);